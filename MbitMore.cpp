@@ -138,4 +138,20 @@ namespace MbitMore {
 #endif // MICROBIT_CODAL
   }
 
+  /**
+   * @brief Set whether received radio packets update the labeled data.
+   * This starts Microbit More service if it was not available.
+   * 
+   * @param on true to update the labeled data
+   */
+  //%
+  void call_setRadioBridge(bool on) {
+#if MICROBIT_CODAL
+    if (NULL == _pService)
+      startMbitMoreService();
+
+    _pService->setRadioBridge(on);
+#endif // MICROBIT_CODAL
+  }
+
 } // namespace MbitMore
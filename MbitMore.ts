@@ -103,4 +103,19 @@ namespace MbitMore {
     console.log("Microbit-More send a text: " + label + " = " + textData);
   }
 
+  /**
+   * Update data with label by radio packets from other micro:bits.
+   * A value packet updates the number with its name as label,
+   * a number or string packet updates the data with label "radio".
+   * @param on true to update data by radio packets
+   */
+  //% blockId=MbitMore_setRadioBridge
+  //% block="update data by radio $on"
+  //% shim=MbitMore::call_setRadioBridge
+  //% on.shadow="toggleOnOff"
+  //% on.defl=true
+  export function setRadioBridge(on: boolean): void {
+    console.log("Microbit-More radio bridge: " + on);
+  }
+
 } // namespace MbitMore
\ No newline at end of file
@@ -11,6 +11,11 @@
 #define MBIT_MORE_USE_SERIAL 1 // 1 for use USB serial
 #endif // MICROBIT_CODAL
 
+// Radio is enabled at the first radio command or bridge use to save memory and
+// power. Boards which receive remote commands, beacons, telemetry or relays
+// without any host set 1 here or store RADIO_ON_START by the config command.
+#define MBIT_MORE_RADIO_ON_START 0 // 1 for enable radio at start
+
 #define MBIT_MORE_DATA_RECEIVED 8000
 
 /**
@@ -37,7 +42,8 @@ enum MbitMoreCommand // 3 bits (0x00..0x07)
   CMD_DISPLAY = 0x02,
   CMD_AUDIO = 0x03,
   CMD_DATA = 0x04,
-  CMD_RADIO = 0x05 //add radio function 
+  CMD_RADIO = 0x05, //add radio function 
+  CMD_SEQUENCE = 0x06 // timed output sequence
 };
 
 enum MbitMorePinCommand
@@ -47,6 +53,8 @@ enum MbitMorePinCommand
   SET_SERVO = 0x03,
   SET_PULL = 0x04,
   SET_EVENT = 0x05,
+  SET_OUTPUTS = 0x06, // set digital values of pins in a mask at once
+  GET_INPUTS = 0x07, // read digital values of pins in a mask at once, outputs are read as driven and PWM is not read
 };
 
 enum MbitMoreDisplayCommand
@@ -79,13 +87,19 @@ enum MbitMoreDataFormat
   PIN_EVENT = 0x11,
   ACTION_EVENT = 0x12,
   DATA_NUMBER = 0x13,
-  DATA_TEXT = 0x14
+  DATA_TEXT = 0x14,
+  PIN_EDGES = 0x15, // batch of edges captured in [us]
+  PIN_COUNT = 0x16, // edges counted in a gate time
+  PIN_INPUTS = 0x17, // digital values of pins read at once
+  PIN_EVENTS = 0x18, // batch of pin events
+  ACTION_EVENTS = 0x19 // batch of button and gesture events
 };
 
 enum MbitMoreActionEvent
 {
   BUTTON = 0x01,
-  GESTURE = 0x02
+  GESTURE = 0x02,
+  RULE_DISABLED = 0x03 // a rule was disabled because its pin left analog input
 };
 
 enum MbitMoreButtonEvent
@@ -118,7 +132,9 @@ enum MbitMorePinEventType
   NONE = 0,
   ON_EDGE = 1,
   ON_PULSE = 2,
-  ON_TOUCH = 3
+  ON_TOUCH = 3,
+  ON_CAPTURE = 4, // capture edges in [us] and send them in batches
+  ON_COUNT = 5 // count edges and send the result each gate time
 };
 
 enum MbitMorePinEvent
@@ -136,7 +152,55 @@ enum MbitMorePinEvent
 enum MbitMoreConfig
 {
   MIC = 0x01, // microphone
-  TOUCH = 0x02
+  TOUCH = 0x02,
+  COMPASS_CALIBRATE = 0x03, // calibrate and store in the storage
+  STATE_PUSH = 0x04, // send state as soon as inputs changed
+  EVENT_MASK = 0x05, // select events to send for a source
+  TIMESTAMP = 0x06, // send events with uint64_t timestamp [us]
+  RULE = 0x07, // set an event-action rule
+  RADIO_ON_START = 0x08 // store to enable radio at start
+};
+
+/**
+ * @brief Enum for triggers of event-action rules.
+ * 
+ */
+enum MbitMoreRuleTrigger
+{
+  RULE_NONE = 0, // remove the rule
+  RULE_PIN = 1, // pin event on a pin
+  RULE_BUTTON = 2, // button event on a MbitMoreEventMaskSource
+  RULE_GESTURE = 3,
+  RULE_ABOVE = 4, // analog value on a pin crosses up the threshold
+  RULE_BELOW = 5 // analog value on a pin crosses down the threshold
+};
+
+/**
+ * @brief Enum for actions of event-action rules.
+ * 
+ */
+enum MbitMoreRuleAction
+{
+  ACTION_DIGITAL = 1,
+  ACTION_PWM = 2,
+  ACTION_TONE = 3,
+  ACTION_DISPLAY = 4
+};
+
+/**
+ * @brief Enum for sources of events which have a mask.
+ * 
+ */
+enum MbitMoreEventMaskSource
+{
+  MASK_BUTTON_A = 0,
+  MASK_BUTTON_B = 1,
+  MASK_LOGO = 2,
+  MASK_TOUCH_P0 = 3,
+  MASK_TOUCH_P1 = 4,
+  MASK_TOUCH_P2 = 5,
+  MASK_GESTURE = 6,
+  MASK_PIN = 7 // all of GPIO pins
 };
 
 /**
@@ -149,4 +213,27 @@ enum MbitMoreAudioCommand
   PLAY_TONE = 0x01,
 };
 
+/**
+ * @brief Enum for sub-commands about the output sequence.
+ * 
+ */
+enum MbitMoreSequenceCommand
+{
+  SEQUENCE_CLEAR = 0x00, // stop and remove all steps
+  SEQUENCE_ADD = 0x01,   // append steps
+  SEQUENCE_PLAY = 0x02,  // play from the first step
+  SEQUENCE_STOP = 0x03
+};
+
+/**
+ * @brief Enum for actions of a step in the output sequence.
+ * 
+ */
+enum MbitMoreSequenceAction
+{
+  STEP_DIGITAL = 0x00,
+  STEP_PWM = 0x01,
+  STEP_SERVO = 0x02
+};
+
 #endif // MBIT_MORE_COMMON_H
@@ -87,9 +87,61 @@ void copyManagedString(char *dst, ManagedString mstr, size_t maxLength) {
 #define MBIT_MORE_DATA_FORMAT_INDEX 19
 
 #include "MbitMoreDevice.h"
+#include "nrf.h"
 
 #include "MbitMoreRadio.h" //add radio service
- //add radio serivice
+#include "MbitMoreRadioPacket.h"
+
+/**
+ * @brief Calibrate the compass of Microbit More.
+ * 
+ */
+void calibrateMbitMoreCompass() {
+  MbitMoreDevice::getInstance().calibrateCompass();
+}
+
+/**
+ * @brief Send state of Microbit More after the min interval.
+ * 
+ */
+void pushMbitMoreStateLater() {
+  MbitMoreDevice::getInstance().pushStateLater();
+}
+
+/**
+ * @brief Play the output sequence of Microbit More.
+ * 
+ */
+void playMbitMoreSequence() {
+  MbitMoreDevice::getInstance().playSequence();
+}
+
+#if !MICROBIT_CODAL
+/**
+ * @brief Wake the fiber playing the output sequence of Microbit More.
+ * This is called by the timeout in an interrupt.
+ * 
+ */
+void wakeMbitMoreSequence() {
+  MbitMoreDevice::getInstance().wakeSequence();
+}
+#endif // !MICROBIT_CODAL
+
+/**
+ * @brief Start a process to send events of Microbit More.
+ * 
+ */
+void startMbitMoreEventSending() {
+  MbitMoreDevice::getInstance().startEventSending();
+}
+
+/**
+ * @brief Start a process to wake the sender of events periodically.
+ * 
+ */
+void startMbitMoreEventTicking() {
+  MbitMoreDevice::getInstance().startEventTicking();
+}
 
 /**
  * Constructor.
@@ -102,13 +154,13 @@ MbitMoreDevice::MbitMoreDevice(MicroBit &_uBit) : uBit(_uBit) {
   // On microbit-v2, re-calibration destract compass heading.
 #else // NOT MICROBIT_CODAL
   if (uBit.buttonA.isPressed()) {
-    uBit.compass.clearCalibration();
+    calibrateCompass();
   }
 #endif // NOT MICROBIT_CODAL
 
-  // Compass must be calibrated before starting bluetooth service.
+  // Compass is calibrated only on request and restored at boot to start serving quickly.
   if (!uBit.compass.isCalibrated()) {
-    uBit.compass.calibrate();
+    restoreCompassCalibration();
   }
 
   displayVersion();
@@ -118,13 +170,13 @@ MbitMoreDevice::MbitMoreDevice(MicroBit &_uBit) : uBit(_uBit) {
       MICROBIT_ID_BUTTON_A, MICROBIT_EVT_ANY,
       this,
       &MbitMoreDevice::onButtonChanged,
-      MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY);
+      MESSAGE_BUS_LISTENER_IMMEDIATE);
   uBit.messageBus.listen(
       MICROBIT_ID_BUTTON_B,
       MICROBIT_EVT_ANY,
       this,
       &MbitMoreDevice::onButtonChanged,
-      MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY);
+      MESSAGE_BUS_LISTENER_IMMEDIATE);
 
 #if MICROBIT_CODAL
   uBit.messageBus.listen(
@@ -132,7 +184,7 @@ MbitMoreDevice::MbitMoreDevice(MicroBit &_uBit) : uBit(_uBit) {
       MICROBIT_EVT_ANY,
       this,
       &MbitMoreDevice::onButtonChanged,
-      MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY);
+      MESSAGE_BUS_LISTENER_IMMEDIATE);
 #endif // MICROBIT_CODAL
 
   uBit.messageBus.listen(
@@ -140,7 +192,16 @@ MbitMoreDevice::MbitMoreDevice(MicroBit &_uBit) : uBit(_uBit) {
       MICROBIT_EVT_ANY,
       this,
       &MbitMoreDevice::onGestureChanged,
-      MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY);
+      MESSAGE_BUS_LISTENER_IMMEDIATE);
+
+  // Buttons are maintained by the events from now on.
+  eventInputs = (1 << MbitMoreButtonStateIndex::A) | (1 << MbitMoreButtonStateIndex::B);
+  setInputLevel(MbitMoreButtonStateIndex::A, uBit.buttonA.isPressed());
+  setInputLevel(MbitMoreButtonStateIndex::B, uBit.buttonB.isPressed());
+#if MICROBIT_CODAL
+  eventInputs |= (1 << MbitMoreButtonStateIndex::LOGO);
+  setInputLevel(MbitMoreButtonStateIndex::LOGO, uBit.logo.isPressed());
+#endif // MICROBIT_CODAL
 /**
   uBit.messageBus.listen(
       MICROBIT_ID_BLE,
@@ -155,80 +216,160 @@ MbitMoreDevice::MbitMoreDevice(MicroBit &_uBit) : uBit(_uBit) {
       &MbitMoreDevice::onBLEDisconnected,
       MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY);
 */ // add disable BLE
+  for (size_t i = 0; i < MBIT_MORE_PIN_COUNTER_SLOTS; i++) {
+    pinCounters[i].pinIndex = 0xFF;
+  }
+  for (size_t i = 0; i < MBIT_MORE_EVENT_MASK_SOURCES; i++) {
+    eventMasks[i] = 0xFFFF;
+  }
+  for (size_t i = 0; i < MBIT_MORE_RULE_SLOTS; i++) {
+    rules[i].trigger = MbitMoreRuleTrigger::RULE_NONE;
+  }
+  create_fiber(startMbitMoreEventSending);
+
 #if MBIT_MORE_USE_SERIAL
   serialService = new MbitMoreSerial(*this);
   
 #endif // MBIT_MORE_USE_SERIAL
 
-  uBit.messageBus.listen(MICROBIT_ID_RADIO, 
-  MICROBIT_RADIO_EVT_DATAGRAM,
-   this,
-   &MbitMoreDevice::onRadioreceived,
-  MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY
-   );
-
-
+  // Boards without host must listen for remote commands, beacons and relays.
+#if MBIT_MORE_RADIO_ON_START
+  radio();
+#else // NOT MBIT_MORE_RADIO_ON_START
+  if (isRadioOnStart()) {
+    radio();
+  }
+#endif // NOT MBIT_MORE_RADIO_ON_START
+}
 
+/**
+ * @brief Return the radio and enable it at the first call.
+ * Radio is not enabled until a radio command or the bridge is used to save
+ * memory and power on micro:bits without radio, unless MBIT_MORE_RADIO_ON_START
+ * is 1 or RADIO_ON_START is stored.
+ *
+ * @return MbitMoreRadio* radio of Microbit More
+ */
+MbitMoreRadio *MbitMoreDevice::radio() {
+  if (Radio != NULL)
+    return Radio;
   Radio = new MbitMoreRadio(*this);
-  //uBit.radio.enable();
-
- 
-
-
-
-
+  uBit.messageBus.listen(
+      MICROBIT_ID_RADIO,
+      MICROBIT_RADIO_EVT_DATAGRAM,
+      this,
+      &MbitMoreDevice::onRadioreceived,
+      MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY);
+  return Radio;
 }
 
+/**
+ * @brief Return the timestamp of the event in the clock shared by radio.
+ *
+ * @param evt event which has the timestamp
+ * @return uint32_t timestamp downcast from uint64_t value
+ */
+uint32_t MbitMoreDevice::eventTimestamp(MicroBitEvent &evt) {
+  if (Radio == NULL)
+    return (uint32_t)evt.timestamp;
+  return (uint32_t)Radio->sharedTime(evt.timestamp);
+}
 
-
-
-
-void MbitMoreDevice::onRadioreceived( MicroBitEvent e){
-     PacketBuffer b;
-b = uBit.radio.datagram.recv();
-
-int length = b.length();
-uint8_t *bytes = b.getBytes();
-int signal = b.getRSSI();
-uint8_t signalbuf [4] ={ 
-  (signal >> 24) & 0xFF, 
-   (signal >> 16) & 0xFF, 
-    (signal >> 8) & 0xFF, 
-     (signal >> 0) & 0xFF, 
-
-  /**
-static_cast<uint8_t>((signal >> 24  ) & 0xFF ),
-static_cast<uint8_t>((signal >>16 ) & 0xFF) ,
-static_cast<uint8_t>((signal >>8 ) & 0xFF),
-static_cast<uint8_t>((signal >> 0 )& 0xFF )
-*/
-};
-   
-
-uint8_t buf[RADIOSENDPACKETSIZE]; //[0...31]=radio packet [32..35]=RSSI
-
- memset(buf, 0, sizeof(buf));
-  memcpy(buf, bytes, length);
-  for (int i = 0 ;i<4;i++) {buf [32+i] = signalbuf[i];};
-
-  uint8_t *sendBufpointer = buf;
-
-  if (serialConnected) {
-    serialService->notifyOnSerial(0x0140, sendBufpointer, RADIOSENDPACKETSIZE);
-   
-
-
+/**
+ * @brief Put the timestamp of the event in the format selected by the host.
+ * Extended timestamp is uint64_t [us] since boot as little-endian (8 bytes),
+ * otherwise uint32_t in the clock shared by radio (4 bytes).
+ * Timestamps of events are in [ms] on v1 then they are scaled to [us].
+ *
+ * @param data buffer to put the timestamp
+ * @param evt event which has the timestamp
+ */
+void MbitMoreDevice::putEventTimestamp(uint8_t *data, MicroBitEvent &evt) {
+  if (!extendedTimestamp) {
+    uint32_t timestamp = eventTimestamp(evt);
+    memcpy(data, &timestamp, 4);
     return;
   }
+  uint64_t timestamp = eventTimeUs(evt);
+  memcpy(data, &timestamp, 8);
+}
 
+/**
+ * @brief Return the timestamp of the event in [us] since boot.
+ * Timestamps of events are in [ms] on v1 then they are scaled to [us].
+ *
+ * @param evt event which has the timestamp
+ * @return uint64_t timestamp [us]
+ */
+uint64_t MbitMoreDevice::eventTimeUs(MicroBitEvent &evt) {
+#if MICROBIT_CODAL
+  return evt.timestamp;
+#else // NOT MICROBIT_CODAL
+  return (uint64_t)evt.timestamp * 1000;
+#endif // NOT MICROBIT_CODAL
+}
 
-  //MbitMoreSerial::notifyOnSerial(0x0200, sendBufpointer,RADIOSENDPACKETSIZE);
+/**
+ * @brief Put the interval as unsigned LEB128.
+ *
+ * @param data buffer to put the interval, which has room for 5 bytes
+ * @param interval interval to put
+ * @return size_t length of the encoded interval
+ */
+static size_t putEncodedInterval(uint8_t *data, uint32_t interval) {
+  size_t length = 0;
+  do {
+    data[length] = interval & 0x7F;
+    interval >>= 7;
+    if (interval > 0)
+      data[length] |= 0x80;
+    length++;
+  } while (interval > 0);
+  return length;
+}
 
 
 
-    
 
 
+/**
+ * @brief Invoked when a datagram was received on the radio.
+ * Forward all waiting datagrams with RSSI to the host.
+ *
+ * @param e event of the radio
+ */
+void MbitMoreDevice::onRadioreceived(MicroBitEvent e) {
+  uint8_t *packet;
+  size_t length;
+  size_t received = 0;
+  // Timestamp of the event is when the first datagram arrived without delay of the scheduler.
+  // Following datagrams arrived after that and are stamped when they are taken.
+  uint64_t receivedAt = e.timestamp;
+  bool first = true;
+  while (NULL != (packet = Radio->receivePacket(&length))) {
+    if (!first)
+      receivedAt = MbitMoreRadio::localClock();
+    first = false;
+    if (packet[0] == MbitMoreRadioPacketState::FRAME) {
+      // Frames of Microbit More protocol are processed on this micro:bit
+      // and never dropped by the queue depth.
+      Radio->receiveFrame(packet, length, receivedAt);
+      continue;
+    }
+    // Drop datagrams to the host over the queue depth (they were counted in the node table).
+    if (received++ >= Radio->queueDepth)
+      continue;
+#if MICROBIT_CODAL
+    if (radioBridge) {
+      bridgeRadioPacket(packet, length);
+    }
+#endif // MICROBIT_CODAL
+#if MBIT_MORE_USE_SERIAL
+    if (serialConnected) {
+      serialService->notifyOnSerial(0x0140, packet, RADIOSENDPACKETSIZE);
+    }
+#endif // MBIT_MORE_USE_SERIAL
+  }
 }
 
 MbitMoreDevice::~MbitMoreDevice() {
@@ -240,6 +381,15 @@ MbitMoreDevice::~MbitMoreDevice() {
                          &MbitMoreDevice::onGestureChanged);
   uBit.messageBus.ignore(MICROBIT_ID_ANY, MICROBIT_EVT_ANY, this,
                          &MbitMoreDevice::onPinEvent);
+  uBit.messageBus.ignore(MICROBIT_ID_ANY, MICROBIT_EVT_ANY, this,
+                         &MbitMoreDevice::onPinEdgeCaptured);
+  uBit.messageBus.ignore(MICROBIT_ID_ANY, MICROBIT_EVT_ANY, this,
+                         &MbitMoreDevice::onPinEdgeCounted);
+  if (Radio != NULL) {
+    uBit.messageBus.ignore(MICROBIT_ID_RADIO, MICROBIT_RADIO_EVT_DATAGRAM, this,
+                           &MbitMoreDevice::onRadioreceived);
+    delete Radio;
+  }
   delete basicService;
 }
 
@@ -333,7 +483,29 @@ void MbitMoreDevice::onCommandReceived(uint8_t *data, size_t length) {
     }
   } else if (command == MbitMoreCommand::CMD_PIN) {
     const int pinCommand = data[0] & 0b11111;
+    if (pinCommand == MbitMorePinCommand::SET_OUTPUTS) {
+      // mask and values are read as uint32_t little-endian which have a bit for each pin index.
+      if (length < 9)
+        return;
+      uint32_t mask;
+      memcpy(&mask, &(data[1]), 4);
+      uint32_t values;
+      memcpy(&values, &(data[5]), 4);
+      setDigitalValues(mask, values);
+      return;
+    } else if (pinCommand == MbitMorePinCommand::GET_INPUTS) {
+      // mask is read as uint32_t little-endian.
+      if (length < 5)
+        return;
+      uint32_t mask;
+      memcpy(&mask, &(data[1]), 4);
+      sendDigitalValues(mask);
+      return;
+    }
+    // Pin index from the host is used only when it is in the GPIO table.
     int pinIndex = (int)data[1];
+    if (!isGpio(pinIndex))
+      return;
     if (pinCommand == MbitMorePinCommand::SET_PULL) {
       uBit.io.pin[pinIndex].getDigitalValue(); // set the pin to input mode
       setPullMode(pinIndex, (MbitMorePullMode)data[2]);
@@ -360,6 +532,7 @@ void MbitMoreDevice::onCommandReceived(uint8_t *data, size_t length) {
       // center is read as uint16_t little-endian.
       uint16_t center;
       memcpy(&center, &(data[6]), 2);
+      releasePinInput(pinIndex);
       if (range == 0) {
         uBit.io.pin[pinIndex].setServoValue(angle);
       } else if (center == 0) {
@@ -368,7 +541,12 @@ void MbitMoreDevice::onCommandReceived(uint8_t *data, size_t length) {
         uBit.io.pin[pinIndex].setServoValue(angle, range, center);
       }
     } else if (pinCommand == MbitMorePinCommand::SET_EVENT) {
-      listenPinEventOn(pinIndex, (int)data[2]);
+      // Gate time of counting mode is read as uint16_t little-endian when it was sent.
+      uint16_t gateTime = MBIT_MORE_PIN_COUNTER_GATE_TIME;
+      if (length >= 5) {
+        memcpy(&gateTime, &(data[3]), 2);
+      }
+      listenPinEventOn(pinIndex, (int)data[2], gateTime);
     }
     touchMode[pinIndex] = false;
   } else if (command == MbitMoreCommand::CMD_AUDIO) {
@@ -383,13 +561,8 @@ void MbitMoreDevice::onCommandReceived(uint8_t *data, size_t length) {
 #if MICROBIT_CODAL
   } else if (command == MbitMoreCommand::CMD_DATA) {
     MbitMoreDataContentType dataType = (MbitMoreDataContentType)(data[0] & 0b11111);
-    int index = findWaitingDataLabelIndex((char *)(&data[1]), dataType);
-    if (index != MBIT_MORE_WAITING_DATA_LABEL_NOT_FOUND) {
-      int contentStart = 1 + MBIT_MORE_DATA_LABEL_SIZE;
-      memset(receivedData[index].content, 0, MBIT_MORE_DATA_CONTENT_SIZE);
-      memcpy(receivedData[index].content, &data[contentStart], length - contentStart);
-      MicroBitEvent evt(MBIT_MORE_DATA_RECEIVED, index + 1);
-    }
+    int contentStart = 1 + MBIT_MORE_DATA_LABEL_SIZE;
+    receiveLabeledData((char *)(&data[1]), dataType, &data[contentStart], length - contentStart);
 #endif // MICROBIT_CODAL
   } else if (command == MbitMoreCommand::CMD_CONFIG) {
     const int config = data[0] & 0b11111;
@@ -408,120 +581,157 @@ void MbitMoreDevice::onCommandReceived(uint8_t *data, size_t length) {
             MICROBIT_EVT_ANY,
             this,
             &MbitMoreDevice::onButtonChanged,
-            MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY);
+            MESSAGE_BUS_LISTENER_IMMEDIATE);
 #if MICROBIT_CODAL
-        uBit.io.pin[pinIndex].isTouched(codal::TouchMode::Capacitative);
+        bool touched = uBit.io.pin[pinIndex].isTouched(codal::TouchMode::Capacitative);
 #else // NOT MICROBIT_CODAL
-        uBit.io.pin[pinIndex].isTouched();
+        bool touched = uBit.io.pin[pinIndex].isTouched();
 #endif // NOT MICROBIT_CODAL
         touchMode[pinIndex] = true;
+        setInputLevel(MbitMoreButtonStateIndex::P0 + pinIndex, touched);
+        eventInputs |= (1 << (MbitMoreButtonStateIndex::P0 + pinIndex));
       } else {
         uBit.messageBus.ignore(
             componentID,
             MICROBIT_EVT_ANY,
             this,
             &MbitMoreDevice::onButtonChanged);
+        eventInputs &= ~(1 << (MbitMoreButtonStateIndex::P0 + pinIndex));
       }
+    } else if (config == MbitMoreConfig::COMPASS_CALIBRATE) {
+      // Calibration waits for the user in another fiber not to block receiving.
+      create_fiber(calibrateMbitMoreCompass);
+    } else if (config == MbitMoreConfig::STATE_PUSH) {
+      // min interval [ms] is read as uint16_t little-endian.
+      uint16_t interval = MBIT_MORE_STATE_PUSH_INTERVAL;
+      if (length >= 4) {
+        memcpy(&interval, &data[2], 2);
+      }
+      statePushInterval = (data[1] == 1) ? ((interval > 0) ? interval : 1) : 0;
+    } else if (config == MbitMoreConfig::EVENT_MASK) {
+      // mask is read as uint16_t little-endian.
+      if (length < 4 || data[1] >= MBIT_MORE_EVENT_MASK_SOURCES)
+        return;
+      uint16_t mask;
+      memcpy(&mask, &data[2], 2);
+      eventMasks[data[1]] = mask;
+    } else if (config == MbitMoreConfig::TIMESTAMP) {
+      extendedTimestamp = (data[1] == 1);
+    } else if (config == MbitMoreConfig::RULE) {
+      setRule(data, length);
+    } else if (config == MbitMoreConfig::RADIO_ON_START) {
+      setRadioOnStart(data[1] == 1);
     }
-    //radio function
-    } else if (command == MbitMoreCommand::CMD_RADIO) {
-     
-      
-
-  
-    const uint8_t Radiocommand = data[0] & 0b11111;
-    
-
-
-    if (Radiocommand == MbitMoreRadioControlCommand::SETGROUP ){
-     
-      uint8_t group = data[1];
-      Radio->Radiosetgroup(group);
-      
-    } else if (Radiocommand == MbitMoreRadioControlCommand::SETSIGNALPOWER){
-      uint8_t singnalpower = data[1];
-       Radio->Radiosetsignalpower(singnalpower); 
-
-    } else if (Radiocommand == MbitMoreRadioControlCommand::SENDSTRING){
-        uint8_t buf[RADIOPACKETSIZE] ;
-
-      
-      memset(buf, 0, sizeof(buf));
-      memcpy(&buf[10], (&data[1]), length - 2);
-      buf[0]= MbitMoreRadioPacketState::STRING; 
-      buf[1]=0x64; //dummy 
-      buf[2]=0x64; //dummy
-      buf[9]= length -2;
-      Radio->sendrawpacket(buf,RADIOPACKETSIZE);
-      /**
-      * PacketBuffer b(buf,RADIOPACKETSIZE);
-      *uBit.radio.datagram.send(b);
-      */
-    
-      
-
-      
-
-      
-  
-    } else if(Radiocommand == MbitMoreRadioControlCommand::SENDINTNUMBER){
-      
-     uint8_t buf[RADIOPACKETSIZE] ;
-
-      
-      memset(buf, 0, sizeof(buf));
-      memcpy(&buf[9], (&data[1]), length - 2);
-      buf[0]= MbitMoreRadioPacketState::NUM; 
-      buf[1]=0x64; //dummy 
-      buf[2]=0x64; //dummy
-      Radio->sendrawpacket(buf,RADIOPACKETSIZE);
-    
-
-      
-
-    } else if(Radiocommand == MbitMoreRadioControlCommand::SENDVALUE){
-       uint8_t buf[RADIOPACKETSIZE] ;
-
-      
-      memset(buf, 0, sizeof(buf));
-      memcpy(&buf[9], (&data[1]), length - 2);
-      buf[0]= MbitMoreRadioPacketState::value; 
-      buf[1]=0x64; //dummy 
-      buf[2]=0x64; //dummy
-      Radio->sendrawpacket(buf,RADIOPACKETSIZE);
-
-
-    
-
-    } else if(Radiocommand == MbitMoreRadioControlCommand::SENDDOUBLENUMBER){
-      uint8_t buf[RADIOPACKETSIZE];
-
-      
-      memset(buf, 0, sizeof(buf));
-      memcpy(&buf[9], (&data[1]), length - 2);
-      buf[0]= MbitMoreRadioPacketState::DOUBLE; 
-      buf[1]=0x64; //dummy 
-      buf[2]=0x64; //dummy
-      Radio->sendrawpacket(buf,RADIOPACKETSIZE);
-    
-      //error
-      
-
-
-    }else {    uBit.display.scrollAsync(Radiocommand);
-
+  } else if (command == MbitMoreCommand::CMD_SEQUENCE) {
+    onSequenceCommand(data, length);
+  } else if (command == MbitMoreCommand::CMD_RADIO) {
+    radio(); // Enable the radio at the first command.
+    const uint8_t radioCommand = data[0] & 0b11111;
+    if (radioCommand == MbitMoreRadioControlCommand::SETGROUP) {
+      Radio->Radiosetgroup(data[1]);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SETSIGNALPOWER) {
+      Radio->Radiosetsignalpower(data[1]);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SETFREQUENCYBAND) {
+      Radio->setFrequencyBand(data[1]);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SETDATARATE) {
+      Radio->setDataRate((MbitMoreRadioDataRate)data[1]);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SETQUEUEDEPTH) {
+      Radio->queueDepth = (data[1] > 0) ? data[1] : 1;
+    } else if (radioCommand == MbitMoreRadioControlCommand::GETLASTPACKETSIGNAL) {
+#if MBIT_MORE_USE_SERIAL
+      if (serialConnected) {
+        // RSSI is sent as int32_t big-endian as same as forwarded packets.
+        int signal = Radio->lastPacketSignal();
+        uint8_t signalData[4] = {
+            (uint8_t)((signal >> 24) & 0xFF),
+            (uint8_t)((signal >> 16) & 0xFF),
+            (uint8_t)((signal >> 8) & 0xFF),
+            (uint8_t)(signal & 0xFF)};
+        serialService->notifyOnSerial(0x0142, signalData, 4);
+      }
+#endif // MBIT_MORE_USE_SERIAL
+    } else if (radioCommand == MbitMoreRadioControlCommand::SENDMESSAGE) {
+      // content is data[1..(length - 1)] which can be longer than a radio packet.
+      Radio->sendMessage(&data[1], length - 1);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SENDRELIABLE) {
+      // destination is read as uint32_t little-endian and followed by the content.
+      if (length < (1 + 4))
+        return;
+      uint32_t destination;
+      memcpy(&destination, &data[1], 4);
+      Radio->sendReliable(destination, &data[5], length - 5);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SETRELAY) {
+      if (length < 2)
+        return;
+      Radio->setRelay(data[1] != 0, (length > 2) ? data[2] : MBIT_MORE_RADIO_RELAY_TTL);
+    } else if (radioCommand == MbitMoreRadioControlCommand::REMOTECOMMAND) {
+      // destination is read as uint32_t little-endian and followed by options and the command.
+      if (length < (1 + 4 + 1 + 1))
+        return;
+      uint32_t destination;
+      memcpy(&destination, &data[1], 4);
+      Radio->sendCommand(destination, data[5], &data[6], length - 6);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SETTELEMETRY) {
+      // interval [ms] is read as uint16_t little-endian.
+      if (length < 3)
+        return;
+      uint16_t interval;
+      memcpy(&interval, &data[1], 2);
+      Radio->setTelemetry(interval);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SETTIMESYNC) {
+      // interval of beacons [ms] is read as uint16_t little-endian.
+      if (length < 2)
+        return;
+      uint16_t interval = MBIT_MORE_RADIO_BEACON_INTERVAL;
+      if (length >= 4) {
+        memcpy(&interval, &data[2], 2);
+      }
+      Radio->setTimeSync((MbitMoreRadioTimeSyncRole)data[1], interval);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SETADAPTIVEPOWER) {
+      // target signal [dBm] is read as int8_t.
+      if (length < 2)
+        return;
+      Radio->setAdaptivePower(data[1] != 0, (length > 2) ? (int8_t)data[2] : MBIT_MORE_RADIO_TARGET_SIGNAL);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SETDUTYCYCLE) {
+      // listen window [ms] is read as uint16_t little-endian.
+      if (length < 2)
+        return;
+      uint16_t window = MBIT_MORE_RADIO_LISTEN_WINDOW;
+      if (length >= 4) {
+        memcpy(&window, &data[2], 2);
+      }
+      Radio->setDutyCycle(data[1] != 0, window);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SETBRIDGE) {
+#if MICROBIT_CODAL
+      radioBridge = (data[1] == 1);
+#endif // MICROBIT_CODAL
+    } else if (radioCommand == MbitMoreRadioControlCommand::SENDSTRING) {
+      // content is data[1..(length - 2)] without the last byte.
+      if (length < 2)
+        return;
+      Radio->sendString(&data[1], length - 2);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SENDINTNUMBER) {
+      // number is read as int32_t little-endian.
+      if (length < (1 + 4 + 1))
+        return;
+      Radio->sendIntNumber(&data[1]);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SENDVALUE) {
+      // number is read as double little-endian and followed by length and name.
+      if (length < (1 + 8 + 1 + 1))
+        return;
+      size_t nameLength = length - (1 + 8 + 1 + 1);
+      if (data[9] < nameLength)
+        nameLength = data[9];
+      Radio->sendValue(&data[1], &data[10], nameLength);
+    } else if (radioCommand == MbitMoreRadioControlCommand::SENDDOUBLENUMBER) {
+      // number is read as double little-endian.
+      if (length < (1 + 8 + 1))
+        return;
+      Radio->sendDoubleNumber(&data[1]);
+    } else {
+      uBit.display.scrollAsync(radioCommand);
     }
-    
-    
-
-
-   }
-    
-
-  
-      
-
-  
+  }
 }
 
 /**
@@ -563,13 +773,16 @@ void MbitMoreDevice::displayText(char *text, int delay) {
 }
 
 /**
- * @brief Update GPIO and sensors state.
+ * @brief Return levels of digital inputs as the bits in the state data.
+ * Inputs with events are taken from the bitmap and others are polled.
  *
- * @param data Buffer for BLE characteristics.
+ * @return uint32_t levels of digital inputs
  */
-void MbitMoreDevice::updateState(uint8_t *data) {
-  uint32_t digitalLevels = 0;
+uint32_t MbitMoreDevice::readDigitalLevels() {
+  uint32_t digitalLevels = inputLevels & eventInputs;
   for (size_t i = 0; i < sizeof(gpioPin) / sizeof(gpioPin[0]); i++) {
+    if (eventInputs & (1 << gpioPin[i]))
+      continue;
     if (uBit.io.pin[gpioPin[i]].isDigital()) {
       if (uBit.io.pin[gpioPin[i]].isInput()) {
         digitalLevels =
@@ -578,20 +791,22 @@ void MbitMoreDevice::updateState(uint8_t *data) {
       }
     }
   }
-  if (touchMode[0]) {
-    digitalLevels = digitalLevels | (uBit.io.pin[0].isTouched() << MbitMoreButtonStateIndex::P0);
-  }
-  if (touchMode[1]) {
-    digitalLevels = digitalLevels | (uBit.io.pin[1].isTouched() << MbitMoreButtonStateIndex::P1);
-  }
-  if (touchMode[2]) {
-    digitalLevels = digitalLevels | (uBit.io.pin[2].isTouched() << MbitMoreButtonStateIndex::P2);
+  for (int i = 0; i < 3; i++) {
+    int index = MbitMoreButtonStateIndex::P0 + i;
+    if (touchMode[i] && !(eventInputs & (1 << index))) {
+      digitalLevels = digitalLevels | (uBit.io.pin[i].isTouched() << index);
+    }
   }
-  digitalLevels = digitalLevels | (uBit.buttonA.isPressed() << MbitMoreButtonStateIndex::A);
-  digitalLevels = digitalLevels | (uBit.buttonB.isPressed() << MbitMoreButtonStateIndex::B);
-#if MICROBIT_CODAL
-  digitalLevels = digitalLevels | (uBit.logo.isPressed() << MbitMoreButtonStateIndex::LOGO);
-#endif // MICROBIT_CODAL
+  return digitalLevels;
+}
+
+/**
+ * @brief Update GPIO and sensors state.
+ *
+ * @param data Buffer for BLE characteristics.
+ */
+void MbitMoreDevice::updateState(uint8_t *data) {
+  uint32_t digitalLevels = readDigitalLevels();
   memcpy(data, (uint8_t *)&digitalLevels, 4);
   data[4] = sampleLightLevel();
   data[5] = (uint8_t)(uBit.thermometer.getTemperature() + 128);
@@ -630,7 +845,11 @@ void MbitMoreDevice::updateMotion(uint8_t *data) {
 
   // Magnetometer
   // Compass Heading is sent as uint16_t little-endian [10..11]
-  uint16_t heading = (uint16_t)normalizeCompassHeading(uBit.compass.heading());
+  // Heading is 0 while not calibrated because heading() starts the calibration.
+  uint16_t heading = 0;
+  if (uBit.compass.isCalibrated()) {
+    heading = (uint16_t)normalizeCompassHeading(uBit.compass.heading());
+  }
   memcpy(&(data[10]), &heading, 2);
 
   int16_t force;
@@ -664,6 +883,8 @@ void MbitMoreDevice::updateAnalogIn(uint8_t *data, size_t pinIndex) {
       analogInSamples[pinIndex][i] = uBit.io.pin[pinIndex].getAnalogValue();
     }
     uint16_t value = median(analogInSamples[pinIndex], ANALOG_IN_SAMPLES_SIZE);
+    analogInValues[pinIndex] = value;
+    analogInReadAt[pinIndex] = (uint32_t)system_timer_current_time();
 
     // analog value (0 to 1023) is sent as uint16_t little-endian.
     memcpy(&(data[0]), &value, 2);
@@ -800,6 +1021,52 @@ ManagedString MbitMoreDevice::dataContentAsText(int labelID) {
   return ManagedString((char *)(receivedData[labelID - 1].content));
 }
 
+/**
+ * @brief Store content for the label and fire the received event.
+ * 
+ * @param dataLabel label of the data (MBIT_MORE_DATA_LABEL_SIZE chars at most)
+ * @param dataType type of the data
+ * @param content content of the data
+ * @param length length of the content
+ */
+void MbitMoreDevice::receiveLabeledData(const char *dataLabel, MbitMoreDataContentType dataType, const uint8_t *content, size_t length) {
+  int index = findWaitingDataLabelIndex(dataLabel, dataType);
+  if (index == MBIT_MORE_WAITING_DATA_LABEL_NOT_FOUND)
+    return;
+  if (length > MBIT_MORE_DATA_CONTENT_SIZE)
+    length = MBIT_MORE_DATA_CONTENT_SIZE;
+  memset(receivedData[index].content, 0, MBIT_MORE_DATA_CONTENT_SIZE);
+  memcpy(receivedData[index].content, content, length);
+  MicroBitEvent evt(MBIT_MORE_DATA_RECEIVED, index + 1);
+}
+
+/**
+ * @brief Update labeled data with the content of a radio packet.
+ * Values are stored as number with their name as label,
+ * numbers and strings are stored with MBIT_MORE_RADIO_BRIDGE_LABEL.
+ * 
+ * @param packet radio packet received
+ * @param length length of the packet
+ */
+void MbitMoreDevice::bridgeRadioPacket(const uint8_t *packet, size_t length) {
+  MbitMoreRadioPacket decoded;
+  if (!decodeMbitMoreRadioPacket(packet, length, &decoded))
+    return;
+  char label[MBIT_MORE_DATA_LABEL_SIZE] = {0};
+  if (decoded.numberSize > 0 && decoded.textLength > 0) {
+    memcpy(label, decoded.text, (decoded.textLength < MBIT_MORE_DATA_LABEL_SIZE ? decoded.textLength : MBIT_MORE_DATA_LABEL_SIZE));
+  } else {
+    strncpy(label, MBIT_MORE_RADIO_BRIDGE_LABEL, MBIT_MORE_DATA_LABEL_SIZE);
+  }
+  if (decoded.numberSize > 0) {
+    // number is stored as float little-endian.
+    float content = mbitMoreRadioPacketNumber(&decoded);
+    receiveLabeledData(label, MbitMoreDataContentType::MM_DATA_NUMBER, (uint8_t *)&content, 4);
+  } else if (decoded.type == MbitMoreRadioPacketState::STRING) {
+    receiveLabeledData(label, MbitMoreDataContentType::MM_DATA_TEXT, decoded.text, decoded.textLength);
+  }
+}
+
 /**
  * @brief Send number with label.
  * 
@@ -857,13 +1124,15 @@ void MbitMoreDevice::sendTextWithLabel(ManagedString dataLabel, ManagedString da
  * 
  * @param pinIndex index in edge pins
  * @param eventType type of events
+ * @param gateTime gate time of counting mode [ms]
  */
-void MbitMoreDevice::listenPinEventOn(int pinIndex, int eventType) {
+void MbitMoreDevice::listenPinEventOn(int pinIndex, int eventType, uint16_t gateTime) {
   if (!isGpio(pinIndex)) {
     return;
   }
   // conventional scheme to convert from pin index to componentID in v1 and v2.
   int componentID = pinIndex + 100;
+  eventInputs &= ~(1 << pinIndex);
   uBit.messageBus.ignore(
       componentID,
       MICROBIT_PIN_EVT_RISE,
@@ -884,20 +1153,79 @@ void MbitMoreDevice::listenPinEventOn(int pinIndex, int eventType) {
       MICROBIT_PIN_EVT_PULSE_LO,
       this,
       &MbitMoreDevice::onPinEvent);
+  uBit.messageBus.ignore(
+      componentID,
+      MICROBIT_PIN_EVT_RISE,
+      this,
+      &MbitMoreDevice::onPinEdgeCaptured);
+  uBit.messageBus.ignore(
+      componentID,
+      MICROBIT_PIN_EVT_FALL,
+      this,
+      &MbitMoreDevice::onPinEdgeCaptured);
+  uBit.messageBus.ignore(
+      componentID,
+      MICROBIT_PIN_EVT_RISE,
+      this,
+      &MbitMoreDevice::onPinEdgeCounted);
+  uBit.messageBus.ignore(
+      componentID,
+      MICROBIT_PIN_EVT_FALL,
+      this,
+      &MbitMoreDevice::onPinEdgeCounted);
+  stopPinCounter(pinIndex);
 
-  if (eventType == MbitMorePinEventType::ON_EDGE) {
+  if (eventType == MbitMorePinEventType::ON_COUNT) {
+    if (!startPinCounter(pinIndex, gateTime)) {
+      uBit.io.pin[pinIndex].eventOn(MICROBIT_PIN_EVENT_NONE);
+      return;
+    }
+    uBit.messageBus.listen(
+        componentID,
+        MICROBIT_PIN_EVT_RISE,
+        this,
+        &MbitMoreDevice::onPinEdgeCounted,
+        MESSAGE_BUS_LISTENER_IMMEDIATE);
+    uBit.messageBus.listen(
+        componentID,
+        MICROBIT_PIN_EVT_FALL,
+        this,
+        &MbitMoreDevice::onPinEdgeCounted,
+        MESSAGE_BUS_LISTENER_IMMEDIATE);
+    eventInputs |= (1 << pinIndex);
+    uBit.io.pin[pinIndex].eventOn(MICROBIT_PIN_EVENT_ON_EDGE);
+  } else if (eventType == MbitMorePinEventType::ON_CAPTURE) {
+    uBit.messageBus.listen(
+        componentID,
+        MICROBIT_PIN_EVT_RISE,
+        this,
+        &MbitMoreDevice::onPinEdgeCaptured,
+        MESSAGE_BUS_LISTENER_IMMEDIATE);
+    uBit.messageBus.listen(
+        componentID,
+        MICROBIT_PIN_EVT_FALL,
+        this,
+        &MbitMoreDevice::onPinEdgeCaptured,
+        MESSAGE_BUS_LISTENER_IMMEDIATE);
+    setInputLevel(pinIndex, uBit.io.pin[pinIndex].getDigitalValue());
+    eventInputs |= (1 << pinIndex);
+    uBit.io.pin[pinIndex].eventOn(MICROBIT_PIN_EVENT_ON_EDGE);
+  } else if (eventType == MbitMorePinEventType::ON_EDGE) {
     uBit.messageBus.listen(
         componentID,
         MICROBIT_PIN_EVT_RISE,
         this,
         &MbitMoreDevice::onPinEvent,
-        MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY);
+        MESSAGE_BUS_LISTENER_IMMEDIATE);
     uBit.messageBus.listen(
         componentID,
         MICROBIT_PIN_EVT_FALL,
         this,
         &MbitMoreDevice::onPinEvent,
-        MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY);
+        MESSAGE_BUS_LISTENER_IMMEDIATE);
+    // Level is read before eventOn() because reading changes the pin to digital input.
+    setInputLevel(pinIndex, uBit.io.pin[pinIndex].getDigitalValue());
+    eventInputs |= (1 << pinIndex);
     uBit.io.pin[pinIndex].eventOn(MICROBIT_PIN_EVENT_ON_EDGE);
   } else if (eventType == MbitMorePinEventType::ON_PULSE) {
     uBit.messageBus.listen(
@@ -905,13 +1233,15 @@ void MbitMoreDevice::listenPinEventOn(int pinIndex, int eventType) {
         MICROBIT_PIN_EVT_PULSE_HI,
         this,
         &MbitMoreDevice::onPinEvent,
-        MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY);
+        MESSAGE_BUS_LISTENER_IMMEDIATE);
     uBit.messageBus.listen(
         componentID,
         MICROBIT_PIN_EVT_PULSE_LO,
         this,
         &MbitMoreDevice::onPinEvent,
-        MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY);
+        MESSAGE_BUS_LISTENER_IMMEDIATE);
+    setInputLevel(pinIndex, uBit.io.pin[pinIndex].getDigitalValue());
+    eventInputs |= (1 << pinIndex);
 #if MICROBIT_CODAL
     // ?? Freeze BLE when onEvent(PULSE) first time. ??
     uBit.io.pin[pinIndex].eventOn(MICROBIT_PIN_EVENT_NONE); // workaround to prevent to freeze BLE
@@ -932,8 +1262,38 @@ void MbitMoreDevice::listenPinEventOn(int pinIndex, int eventType) {
 
 /**
  * Callback. Invoked when a pin event sent.
+ * Listened as immediate to be called in the context which raised the event.
  */
 void MbitMoreDevice::onPinEvent(MicroBitEvent evt) {
+  triggerRules(MbitMoreRuleTrigger::RULE_PIN, evt.source - 100, evt);
+  if (!isEventWanted(MbitMoreEventMaskSource::MASK_PIN, evt.value)) {
+    enqueueEvent(MbitMoreEventKind::EVENT_PIN_LEVEL, evt);
+    return;
+  }
+  enqueueEvent(MbitMoreEventKind::EVENT_PIN, evt);
+}
+
+/**
+ * @brief Keep the state bitmap with a pin event.
+ * Level after the edge or the end of the pulse is kept in the state bitmap.
+ * 
+ * @param evt event of the pin
+ */
+void MbitMoreDevice::updatePinLevel(MicroBitEvent &evt) {
+  int pinIndex = evt.source - 100;
+  if (evt.value == MICROBIT_PIN_EVT_RISE || evt.value == MICROBIT_PIN_EVT_PULSE_LO) {
+    setInputLevel(pinIndex, true);
+  } else if (evt.value == MICROBIT_PIN_EVT_FALL || evt.value == MICROBIT_PIN_EVT_PULSE_HI) {
+    setInputLevel(pinIndex, false);
+  }
+}
+
+/**
+ * @brief Send a pin event to the host.
+ * 
+ * @param evt event of the pin
+ */
+void MbitMoreDevice::sendPinEvent(MicroBitEvent evt) {
   uint8_t *data = moreService->pinEventChBuffer;
 
   // pinIndex is sent as uint8_t.
@@ -942,10 +1302,10 @@ void MbitMoreDevice::onPinEvent(MicroBitEvent evt) {
   // event ID is sent as uint8_t.
   data[1] = (uint8_t)evt.value;
 
-  // event timestamp is sent as uint32_t little-endian
-  // downcast from uint64_t value.
-  uint32_t timestamp = (uint32_t)evt.timestamp;
-  memcpy(&(data[2]), &timestamp, 4);
+  updatePinLevel(evt);
+
+  // event timestamp is sent as uint32_t or uint64_t little-endian
+  putEventTimestamp(&(data[2]), evt);
   data[MBIT_MORE_DATA_FORMAT_INDEX] = MbitMoreDataFormat::PIN_EVENT;
 #if MBIT_MORE_USE_SERIAL
   if (serialConnected) {
@@ -958,47 +1318,708 @@ void MbitMoreDevice::onPinEvent(MicroBitEvent evt) {
 
 /**
  * @brief Invoked when button state changed.
+ * Listened as immediate to be called in the context which raised the event.
  * 
  * @param evt event which has button states
  */
 void MbitMoreDevice::onButtonChanged(MicroBitEvent evt) {
-  uint8_t *data = moreService->actionEventChBuffer;
-  data[0] = MbitMoreActionEvent::BUTTON;
-  // source is a component ID that generated the event as uint16_t little-endian.
-  // MICROBIT_ID_BUTTON_A, MICROBIT_ID_IO_P0, MICROBIT_ID_LOGO, etc.
-  memcpy(&(data[1]), &evt.source, 2);
-  // Event ID send as uint16_t little-endian.
-  // MICROBIT_BUTTON_EVT_DOWN, MICROBIT_BUTTON_EVT_CLICK, etc.
-  data[3] = (uint8_t)evt.value;
-  // Timestamp of the event send as uint32_t little-endian.
-  // downcast from uint64_t value.
-  uint32_t timestamp = (uint32_t)evt.timestamp;
-  memcpy(&(data[4]), &timestamp, 4);
-  data[MBIT_MORE_DATA_FORMAT_INDEX] = MbitMoreDataFormat::ACTION_EVENT;
-#if MBIT_MORE_USE_SERIAL
-  if (serialConnected) {
-    serialService->notifyOnSerial(0x0111, data, MM_CH_BUFFER_SIZE_NOTIFY);
+  int source = -1;
+  if (evt.source == MICROBIT_ID_BUTTON_A) {
+    source = MbitMoreEventMaskSource::MASK_BUTTON_A;
+  } else if (evt.source == MICROBIT_ID_BUTTON_B) {
+    source = MbitMoreEventMaskSource::MASK_BUTTON_B;
+#if MICROBIT_CODAL
+  } else if (evt.source == MICROBIT_ID_LOGO) {
+    source = MbitMoreEventMaskSource::MASK_LOGO;
+#endif // MICROBIT_CODAL
+  } else if (evt.source >= 100 && evt.source <= 102) {
+    source = MbitMoreEventMaskSource::MASK_TOUCH_P0 + (evt.source - 100);
+  }
+  if (source >= 0) {
+    triggerRules(MbitMoreRuleTrigger::RULE_BUTTON, source, evt);
+  }
+  if (source >= 0 && !isEventWanted(source, evt.value)) {
+    // DOWN and UP are still needed to keep the state bitmap.
+    if (evt.value == MICROBIT_BUTTON_EVT_DOWN || evt.value == MICROBIT_BUTTON_EVT_UP) {
+      enqueueEvent(MbitMoreEventKind::EVENT_BUTTON_LEVEL, evt);
+    }
     return;
   }
-#endif // MBIT_MORE_USE_SERIAL
-  moreService->notifyActionEvent();
+  enqueueEvent(MbitMoreEventKind::EVENT_BUTTON, evt);
 }
 
 /**
- * @brief Invoked when gesture state changed.
+ * @brief Whether the event should be sent or not.
  * 
- * @param evt event which has gesture states.
+ * @param source MbitMoreEventMaskSource of the event
+ * @param value event ID
+ * @return true the event is wanted by the host
+ * @return false the event is masked
+ */
+bool MbitMoreDevice::isEventWanted(int source, int value) {
+  if (value < 0 || value > 15)
+    return true;
+  return (eventMasks[source] & (1 << value)) != 0;
+}
+
+/**
+ * @brief Keep the state bitmap with a button event.
+ * 
+ * @param evt event which has button states
+ */
+void MbitMoreDevice::updateButtonLevel(MicroBitEvent &evt) {
+  int index = -1;
+  if (evt.source == MICROBIT_ID_BUTTON_A) {
+    index = MbitMoreButtonStateIndex::A;
+  } else if (evt.source == MICROBIT_ID_BUTTON_B) {
+    index = MbitMoreButtonStateIndex::B;
+#if MICROBIT_CODAL
+  } else if (evt.source == MICROBIT_ID_LOGO) {
+    index = MbitMoreButtonStateIndex::LOGO;
+#endif // MICROBIT_CODAL
+  } else if (evt.source >= 100 && evt.source <= 102) {
+    // touch on P0, P1, P2
+    index = MbitMoreButtonStateIndex::P0 + (evt.source - 100);
+  }
+  if (index >= 0) {
+    if (evt.value == MICROBIT_BUTTON_EVT_DOWN) {
+      setInputLevel(index, true);
+    } else if (evt.value == MICROBIT_BUTTON_EVT_UP) {
+      setInputLevel(index, false);
+    }
+  }
+}
+
+/**
+ * @brief Send a button event to the host.
+ * 
+ * @param evt event which has button states
+ */
+void MbitMoreDevice::sendButtonEvent(MicroBitEvent evt) {
+  updateButtonLevel(evt);
+
+  uint8_t *data = moreService->actionEventChBuffer;
+  data[0] = MbitMoreActionEvent::BUTTON;
+  // source is a component ID that generated the event as uint16_t little-endian.
+  // MICROBIT_ID_BUTTON_A, MICROBIT_ID_IO_P0, MICROBIT_ID_LOGO, etc.
+  memcpy(&(data[1]), &evt.source, 2);
+  // Event ID send as uint16_t little-endian.
+  // MICROBIT_BUTTON_EVT_DOWN, MICROBIT_BUTTON_EVT_CLICK, etc.
+  data[3] = (uint8_t)evt.value;
+  // Timestamp of the event send as uint32_t or uint64_t little-endian.
+  putEventTimestamp(&(data[4]), evt);
+  data[MBIT_MORE_DATA_FORMAT_INDEX] = MbitMoreDataFormat::ACTION_EVENT;
+#if MBIT_MORE_USE_SERIAL
+  if (serialConnected) {
+    serialService->notifyOnSerial(0x0111, data, MM_CH_BUFFER_SIZE_NOTIFY);
+    return;
+  }
+#endif // MBIT_MORE_USE_SERIAL
+  moreService->notifyActionEvent();
+}
+
+/**
+ * @brief Set the level of an input in the state bitmap.
+ *
+ * @param index index of the bit in the state data
+ * @param level level of the input
+ */
+void MbitMoreDevice::setInputLevel(int index, bool level) {
+  uint32_t levels = level ? (inputLevels | (1 << index)) : (inputLevels & ~(1 << index));
+  if (levels == inputLevels)
+    return;
+  inputLevels = levels;
+  if (statePushInterval > 0) {
+    requestStatePush();
+  }
+}
+
+/**
+ * @brief Send state now or after the min interval since the last one.
+ *
+ */
+void MbitMoreDevice::requestStatePush() {
+  if (statePushScheduled)
+    return; // The state will be sent with this change.
+  uint32_t elapsed = (uint32_t)system_timer_current_time() - statePushedAt;
+  if (elapsed >= statePushInterval) {
+    pushState();
+    return;
+  }
+  statePushScheduled = true;
+  create_fiber(pushMbitMoreStateLater);
+}
+
+/**
+ * @brief Send state after the min interval since the last one.
+ *
+ */
+void MbitMoreDevice::pushStateLater() {
+  uint32_t elapsed = (uint32_t)system_timer_current_time() - statePushedAt;
+  if (elapsed < statePushInterval) {
+    fiber_sleep(statePushInterval - elapsed);
+  }
+  statePushScheduled = false;
+  pushState();
+}
+
+/**
+ * @brief Send state with current levels of inputs.
+ * Sensor values are the same as the last polling to send it quickly.
+ *
+ */
+void MbitMoreDevice::pushState() {
+  statePushedAt = (uint32_t)system_timer_current_time();
+#if MBIT_MORE_USE_SERIAL
+  if (!serialConnected)
+    return;
+  uint8_t state[MM_CH_BUFFER_SIZE_STATE];
+  memcpy(state, moreService->stateChBuffer, MM_CH_BUFFER_SIZE_STATE);
+  uint32_t digitalLevels = readDigitalLevels();
+  memcpy(state, (uint8_t *)&digitalLevels, 4);
+  serialService->readResponseOnSerial(0x0101, state, MM_CH_BUFFER_SIZE_STATE);
+#endif // MBIT_MORE_USE_SERIAL
+}
+
+/**
+ * @brief Invoked when gesture state changed.
+ * Listened as immediate to be called in the context which raised the event.
+ * 
+ * @param evt event which has gesture states.
  */
 void MbitMoreDevice::onGestureChanged(MicroBitEvent evt) {
+  triggerRules(MbitMoreRuleTrigger::RULE_GESTURE, 0, evt);
+  if (!isEventWanted(MbitMoreEventMaskSource::MASK_GESTURE, evt.value))
+    return;
+  enqueueEvent(MbitMoreEventKind::EVENT_GESTURE, evt);
+}
+
+/**
+ * @brief Put an event into the ring to be sent by the fiber.
+ * This is the only producer of the ring and may be called in an interrupt,
+ * so that listeners in different interrupts are serialized by disabling IRQ.
+ * The event is dropped when the ring is full.
+ * 
+ * @param kind kind of the event
+ * @param evt event to send
+ */
+void MbitMoreDevice::enqueueEvent(MbitMoreEventKind kind, MicroBitEvent &evt) {
+#if MICROBIT_CODAL
+  target_disable_irq();
+#else // NOT MICROBIT_CODAL
+  __disable_irq();
+#endif // NOT MICROBIT_CODAL
+  uint32_t head = eventRingHead;
+  if ((head - eventRingTail) < MBIT_MORE_EVENT_RING_SIZE) {
+    MbitMoreEventRecord *record = &eventRing[head % MBIT_MORE_EVENT_RING_SIZE];
+    record->kind = kind;
+    record->source = evt.source;
+    record->value = evt.value;
+    record->timestamp = evt.timestamp;
+    // Publish the record after it was written.
+    eventRingHead = head + 1;
+  } else {
+    eventsDropped++;
+  }
+#if MICROBIT_CODAL
+  target_enable_irq();
+#else // NOT MICROBIT_CODAL
+  __enable_irq();
+#endif // NOT MICROBIT_CODAL
+  wakeEventSending();
+}
+
+/**
+ * @brief Wake the fiber sending events if it is waiting.
+ * This may be called in an interrupt.
+ * 
+ */
+void MbitMoreDevice::wakeEventSending() {
+  if (!eventSendingWaiting)
+    return;
+  eventSendingWaiting = false;
+  MicroBitEvent(MBIT_MORE_EVENT_SENDING_ID, MBIT_MORE_EVENT_SENDING_WAKE);
+}
+
+/**
+ * @brief Start the fiber waking the sender periodically if it is not running.
+ * 
+ */
+void MbitMoreDevice::requestEventTicking() {
+  if (eventTicking)
+    return;
+  eventTicking = true;
+  create_fiber(startMbitMoreEventTicking);
+}
+
+/**
+ * @brief Wake the fiber sending events periodically while polled work remains.
+ * 
+ */
+void MbitMoreDevice::startEventTicking() {
+  while (hasPolledWork()) {
+    fiber_sleep(MBIT_MORE_EVENT_POLL_INTERVAL);
+    wakeEventSending();
+  }
+  eventTicking = false;
+}
+
+/**
+ * @brief Return the count of events dropped because a ring was full.
+ * 
+ * @return uint32_t count of dropped events since boot
+ */
+uint32_t MbitMoreDevice::getEventsDropped() {
+  return eventsDropped;
+}
+
+/**
+ * @brief Whether pin counters or threshold rules need polling.
+ * 
+ * @return true polling is needed
+ */
+bool MbitMoreDevice::hasPolledWork() {
+  for (size_t i = 0; i < MBIT_MORE_PIN_COUNTER_SLOTS; i++) {
+    if (pinCounters[i].pinIndex != 0xFF)
+      return true;
+  }
+  for (size_t i = 0; i < MBIT_MORE_RULE_SLOTS; i++) {
+    if (rules[i].trigger == MbitMoreRuleTrigger::RULE_ABOVE || rules[i].trigger == MbitMoreRuleTrigger::RULE_BELOW)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Send events in the ring until empty and wait for the next ones.
+ * This is the only consumer of the ring. It sleeps until a listener puts an event
+ * or the ticking fiber wakes it for pin counters and thresholds.
+ * 
+ */
+void MbitMoreDevice::startEventSending() {
+  while (true) {
+    sendCapturedEdges();
+    sendPinCounts();
+    checkRuleThresholds();
+    sendEvents();
+    // Wait in the queue before checking the rings not to miss a wake in between.
+    fiber_wake_on_event(MBIT_MORE_EVENT_SENDING_ID, MBIT_MORE_EVENT_SENDING_WAKE);
+    eventSendingWaiting = true;
+    if (eventRingTail != eventRingHead || captureRingTail != captureRingHead) {
+      wakeEventSending();
+    }
+    schedule();
+  }
+}
+
+/**
+ * @brief Send events in the ring until it is empty.
+ * Pin events and action events in a row are sent in batches to send a burst
+ * in fewer notifications.
+ * 
+ */
+void MbitMoreDevice::sendEvents() {
+  while (eventRingTail != eventRingHead) {
+    MicroBitEvent evt;
+    MbitMoreEventKind kind = peekEvent(evt);
+    if (kind == MbitMoreEventKind::EVENT_PIN) {
+      sendPinEvents();
+      continue;
+    }
+    if (kind == MbitMoreEventKind::EVENT_BUTTON || kind == MbitMoreEventKind::EVENT_GESTURE) {
+      sendActionEvents();
+      continue;
+    }
+    eventRingTail = eventRingTail + 1;
+    if (kind == MbitMoreEventKind::EVENT_BUTTON_LEVEL) {
+      updateButtonLevel(evt);
+    } else if (kind == MbitMoreEventKind::EVENT_PIN_LEVEL) {
+      updatePinLevel(evt);
+    } else if (kind == MbitMoreEventKind::EVENT_RULE) {
+      if (evt.source < MBIT_MORE_RULE_SLOTS) {
+        runRuleAction(&rules[evt.source]);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Read the event at the tail of the ring without releasing it.
+ * The ring must not be empty.
+ * 
+ * @param evt event to be read
+ * @return MbitMoreEventKind kind of the event
+ */
+MbitMoreEventKind MbitMoreDevice::peekEvent(MicroBitEvent &evt) {
+  MbitMoreEventRecord *record = &eventRing[eventRingTail % MBIT_MORE_EVENT_RING_SIZE];
+  evt.source = record->source;
+  evt.value = record->value;
+  evt.timestamp = record->timestamp;
+  return (MbitMoreEventKind)record->kind;
+}
+
+/**
+ * @brief Send pin events in a row at the tail of the ring in a batch.
+ * A single event is sent as PIN_EVENT. A batch of PIN_EVENTS has [0] count of events,
+ * [1..] timestamp of the first event in the same format as events, then [pin index][event ID]
+ * of each event. Events after the first have the interval [us] from the previous event
+ * as unsigned LEB128 after the event ID.
+ * Slots are released before sending which may wait for the serial.
+ * 
+ */
+void MbitMoreDevice::sendPinEvents() {
+  MicroBitEvent first;
+  peekEvent(first);
+  eventRingTail = eventRingTail + 1;
+  MicroBitEvent evt;
+  if (eventRingTail == eventRingHead || peekEvent(evt) != MbitMoreEventKind::EVENT_PIN) {
+    sendPinEvent(first);
+    return;
+  }
+  uint8_t data[MM_CH_BUFFER_SIZE_NOTIFY] = {0};
+  putEventTimestamp(&data[1], first);
+  size_t offset = 1 + (extendedTimestamp ? 8 : 4);
+  // conventional scheme to convert from componentID to pin index in v1 and v2.
+  data[offset++] = first.source - 100;
+  data[offset++] = (uint8_t)first.value;
+  updatePinLevel(first);
+  uint8_t count = 1;
+  uint64_t lastTime = eventTimeUs(first);
+  while (eventRingTail != eventRingHead && peekEvent(evt) == MbitMoreEventKind::EVENT_PIN) {
+    uint8_t encoded[5];
+    size_t encodedLength = putEncodedInterval(encoded, (uint32_t)(eventTimeUs(evt) - lastTime));
+    if (offset + 2 + encodedLength > MBIT_MORE_DATA_FORMAT_INDEX)
+      break;
+    data[offset++] = evt.source - 100;
+    data[offset++] = (uint8_t)evt.value;
+    memcpy(&data[offset], encoded, encodedLength);
+    offset += encodedLength;
+    count++;
+    lastTime = eventTimeUs(evt);
+    updatePinLevel(evt);
+    eventRingTail = eventRingTail + 1;
+  }
+  data[0] = count;
+  data[MBIT_MORE_DATA_FORMAT_INDEX] = MbitMoreDataFormat::PIN_EVENTS;
+#if MBIT_MORE_USE_SERIAL
+  if (serialConnected) {
+    serialService->notifyOnSerial(0x0110, data, MM_CH_BUFFER_SIZE_NOTIFY);
+    return;
+  }
+#endif // MBIT_MORE_USE_SERIAL
+  memcpy(moreService->pinEventChBuffer, data, MM_CH_BUFFER_SIZE_NOTIFY);
+  moreService->notifyPinEvent();
+}
+
+/**
+ * @brief Send button and gesture events in a row at the tail of the ring in a batch.
+ * A single event is sent as ACTION_EVENT. A batch of ACTION_EVENTS has [0] count of events,
+ * [1..] timestamp of the first event in the same format as events, then
+ * [MbitMoreActionEvent][component ID as uint8_t, 0 for gestures][event ID] of each event.
+ * Events after the first have the interval [us] from the previous event
+ * as unsigned LEB128 after the event ID.
+ * 
+ */
+void MbitMoreDevice::sendActionEvents() {
+  MicroBitEvent first;
+  MbitMoreEventKind kind = peekEvent(first);
+  eventRingTail = eventRingTail + 1;
+  MicroBitEvent evt;
+  MbitMoreEventKind nextKind = (eventRingTail == eventRingHead) ? kind : peekEvent(evt);
+  if (eventRingTail == eventRingHead || (nextKind != MbitMoreEventKind::EVENT_BUTTON && nextKind != MbitMoreEventKind::EVENT_GESTURE)) {
+    if (kind == MbitMoreEventKind::EVENT_BUTTON) {
+      sendButtonEvent(first);
+    } else {
+      sendGestureEvent(first);
+    }
+    return;
+  }
+  uint8_t data[MM_CH_BUFFER_SIZE_NOTIFY] = {0};
+  putEventTimestamp(&data[1], first);
+  size_t offset = 1 + (extendedTimestamp ? 8 : 4);
+  offset += putActionEvent(&data[offset], kind, first);
+  uint8_t count = 1;
+  uint64_t lastTime = eventTimeUs(first);
+  while (eventRingTail != eventRingHead) {
+    kind = peekEvent(evt);
+    if (kind != MbitMoreEventKind::EVENT_BUTTON && kind != MbitMoreEventKind::EVENT_GESTURE)
+      break;
+    uint8_t encoded[5];
+    size_t encodedLength = putEncodedInterval(encoded, (uint32_t)(eventTimeUs(evt) - lastTime));
+    if (offset + 3 + encodedLength > MBIT_MORE_DATA_FORMAT_INDEX)
+      break;
+    offset += putActionEvent(&data[offset], kind, evt);
+    memcpy(&data[offset], encoded, encodedLength);
+    offset += encodedLength;
+    count++;
+    lastTime = eventTimeUs(evt);
+    eventRingTail = eventRingTail + 1;
+  }
+  data[0] = count;
+  data[MBIT_MORE_DATA_FORMAT_INDEX] = MbitMoreDataFormat::ACTION_EVENTS;
+#if MBIT_MORE_USE_SERIAL
+  if (serialConnected) {
+    serialService->notifyOnSerial(0x0111, data, MM_CH_BUFFER_SIZE_NOTIFY);
+    return;
+  }
+#endif // MBIT_MORE_USE_SERIAL
+  memcpy(moreService->actionEventChBuffer, data, MM_CH_BUFFER_SIZE_NOTIFY);
+  moreService->notifyActionEvent();
+}
+
+/**
+ * @brief Put a button or gesture event in a batch of ACTION_EVENTS.
+ * Levels of buttons are kept in the state bitmap as sending each event.
+ * 
+ * @param data buffer to put the event, which has room for 3 bytes
+ * @param kind EVENT_BUTTON or EVENT_GESTURE
+ * @param evt event to put
+ * @return size_t length of the event in the batch
+ */
+size_t MbitMoreDevice::putActionEvent(uint8_t *data, MbitMoreEventKind kind, MicroBitEvent &evt) {
+  if (kind == MbitMoreEventKind::EVENT_BUTTON) {
+    data[0] = MbitMoreActionEvent::BUTTON;
+    data[1] = (uint8_t)evt.source;
+    updateButtonLevel(evt);
+  } else {
+    data[0] = MbitMoreActionEvent::GESTURE;
+    data[1] = 0;
+  }
+  data[2] = (uint8_t)evt.value;
+  return 3;
+}
+
+/**
+ * @brief Callback. Invoked when an edge of a pin in capture mode.
+ * Time is read here in [us] because timestamps of events are in [ms] on v1.
+ *
+ * @param evt event of the edge
+ */
+void MbitMoreDevice::onPinEdgeCaptured(MicroBitEvent evt) {
+  uint32_t time = (uint32_t)system_timer_current_time_us();
+#if MICROBIT_CODAL
+  target_disable_irq();
+#else // NOT MICROBIT_CODAL
+  __disable_irq();
+#endif // NOT MICROBIT_CODAL
+  uint32_t head = captureRingHead;
+  if ((head - captureRingTail) < MBIT_MORE_CAPTURE_RING_SIZE) {
+    MbitMoreEdgeRecord *record = &captureRing[head % MBIT_MORE_CAPTURE_RING_SIZE];
+    record->pinIndex = evt.source - 100;
+    record->level = (evt.value == MICROBIT_PIN_EVT_RISE) ? 1 : 0;
+    record->time = time;
+    captureRingHead = head + 1;
+  } else {
+    eventsDropped++;
+  }
+#if MICROBIT_CODAL
+  target_enable_irq();
+#else // NOT MICROBIT_CODAL
+  __enable_irq();
+#endif // NOT MICROBIT_CODAL
+  wakeEventSending();
+}
+
+/**
+ * @brief Send captured edges in batches until the ring is empty.
+ * A batch has [0] pin index, [1] level after the first edge,
+ * [2..5] time of the first edge [us] as uint32_t little-endian, [6] count of the following edges
+ * and [7..18] intervals [us] from the previous edge as unsigned LEB128.
+ * Levels of the following edges are toggled from the first.
+ *
+ */
+void MbitMoreDevice::sendCapturedEdges() {
+  while (captureRingTail != captureRingHead) {
+    uint8_t data[MM_CH_BUFFER_SIZE_NOTIFY] = {0};
+    MbitMoreEdgeRecord *first = &captureRing[captureRingTail % MBIT_MORE_CAPTURE_RING_SIZE];
+    data[0] = first->pinIndex;
+    data[1] = first->level;
+    memcpy(&data[2], &first->time, 4);
+    setInputLevel(first->pinIndex, first->level);
+    uint32_t lastTime = first->time;
+    uint8_t lastLevel = first->level;
+    captureRingTail = captureRingTail + 1;
+    size_t offset = 7;
+    uint8_t count = 0;
+    while (captureRingTail != captureRingHead) {
+      MbitMoreEdgeRecord *edge = &captureRing[captureRingTail % MBIT_MORE_CAPTURE_RING_SIZE];
+      if (edge->pinIndex != data[0] || edge->level == lastLevel)
+        break; // Another pin or a lost edge starts a new batch.
+      uint8_t encoded[5];
+      size_t encodedLength = putEncodedInterval(encoded, edge->time - lastTime);
+      if (offset + encodedLength > MBIT_MORE_DATA_FORMAT_INDEX)
+        break;
+      memcpy(&data[offset], encoded, encodedLength);
+      offset += encodedLength;
+      count++;
+      lastTime = edge->time;
+      lastLevel = edge->level;
+      setInputLevel(edge->pinIndex, edge->level);
+      captureRingTail = captureRingTail + 1;
+    }
+    data[6] = count;
+    data[MBIT_MORE_DATA_FORMAT_INDEX] = MbitMoreDataFormat::PIN_EDGES;
+#if MBIT_MORE_USE_SERIAL
+    if (serialConnected) {
+      serialService->notifyOnSerial(0x0110, data, MM_CH_BUFFER_SIZE_NOTIFY);
+      continue;
+    }
+#endif // MBIT_MORE_USE_SERIAL
+    memcpy(moreService->pinEventChBuffer, data, MM_CH_BUFFER_SIZE_NOTIFY);
+    moreService->notifyPinEvent();
+  }
+}
+
+/**
+ * @brief Start counting edges on the pin.
+ * The level is read before the listener starts because reading changes the pin to digital input.
+ *
+ * @param pinIndex index in edge pins
+ * @param gateTime gate time [ms]
+ * @return true counting was started
+ * @return false no slot was available
+ */
+bool MbitMoreDevice::startPinCounter(int pinIndex, uint16_t gateTime) {
+  for (size_t i = 0; i < MBIT_MORE_PIN_COUNTER_SLOTS; i++) {
+    MbitMorePinCounter *counter = &pinCounters[i];
+    if (counter->pinIndex != 0xFF)
+      continue;
+    uint32_t now = (uint32_t)system_timer_current_time_us();
+    counter->level = uBit.io.pin[pinIndex].getDigitalValue();
+    counter->gateTime = (gateTime < MBIT_MORE_PIN_COUNTER_MIN_GATE_TIME) ? MBIT_MORE_PIN_COUNTER_MIN_GATE_TIME : gateTime;
+    counter->gateStartedAt = now;
+    counter->rises = 0;
+    counter->firstRise = now;
+    counter->lastRise = now;
+    counter->lastEdge = now;
+    counter->highTime = 0;
+    setInputLevel(pinIndex, counter->level);
+    // Slot is published at last to make the listener see the initialized counter.
+    counter->pinIndex = pinIndex;
+    requestEventTicking();
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Stop counting edges on the pin.
+ *
+ * @param pinIndex index in edge pins
+ */
+void MbitMoreDevice::stopPinCounter(int pinIndex) {
+  for (size_t i = 0; i < MBIT_MORE_PIN_COUNTER_SLOTS; i++) {
+    if (pinCounters[i].pinIndex == pinIndex) {
+      pinCounters[i].pinIndex = 0xFF;
+    }
+  }
+}
+
+/**
+ * @brief Callback. Invoked when an edge of a pin in counting mode.
+ * Only integers are updated here to keep up with edges in several [kHz].
+ *
+ * @param evt event of the edge
+ */
+void MbitMoreDevice::onPinEdgeCounted(MicroBitEvent evt) {
+  uint32_t time = (uint32_t)system_timer_current_time_us();
+  int pinIndex = evt.source - 100;
+  for (size_t i = 0; i < MBIT_MORE_PIN_COUNTER_SLOTS; i++) {
+    MbitMorePinCounter *counter = &pinCounters[i];
+    if (counter->pinIndex != pinIndex)
+      continue;
+    if (evt.value == MICROBIT_PIN_EVT_RISE) {
+      if (counter->rises == 0) {
+        counter->firstRise = time;
+      }
+      counter->lastRise = time;
+      counter->rises = counter->rises + 1;
+      counter->level = 1;
+    } else {
+      if (counter->level) {
+        counter->highTime = counter->highTime + (time - counter->lastEdge);
+      }
+      counter->level = 0;
+    }
+    counter->lastEdge = time;
+    return;
+  }
+}
+
+/**
+ * @brief Send results of pin counters whose gate time has passed.
+ * A result has [0] pin index, [1..4] count of rising edges, [5..8] length of the gate [us],
+ * [9..12] mean period between rising edges [us] (0 when less than two edges)
+ * and [13..14] duty ratio of high level [1/1000] as little-endian.
+ *
+ */
+void MbitMoreDevice::sendPinCounts() {
+  for (size_t i = 0; i < MBIT_MORE_PIN_COUNTER_SLOTS; i++) {
+    MbitMorePinCounter *counter = &pinCounters[i];
+    if (counter->pinIndex == 0xFF)
+      continue;
+    uint32_t now = (uint32_t)system_timer_current_time_us();
+    uint32_t gateLength = now - counter->gateStartedAt;
+    if (gateLength < (uint32_t)counter->gateTime * 1000)
+      continue;
+    // Take the result and open the next gate without losing edges between them.
+#if MICROBIT_CODAL
+    target_disable_irq();
+#else // NOT MICROBIT_CODAL
+    __disable_irq();
+#endif // NOT MICROBIT_CODAL
+    uint32_t rises = counter->rises;
+    uint32_t firstRise = counter->firstRise;
+    uint32_t lastRise = counter->lastRise;
+    uint32_t highTime = counter->highTime;
+    uint8_t level = counter->level;
+    if (level) {
+      highTime += now - counter->lastEdge;
+      counter->lastEdge = now;
+    }
+    counter->rises = 0;
+    counter->highTime = 0;
+    counter->gateStartedAt = now;
+#if MICROBIT_CODAL
+    target_enable_irq();
+#else // NOT MICROBIT_CODAL
+    __enable_irq();
+#endif // NOT MICROBIT_CODAL
+    uint32_t period = (rises > 1) ? ((lastRise - firstRise) / (rises - 1)) : 0;
+    uint16_t duty = (uint16_t)(((uint64_t)highTime * 1000) / gateLength);
+    setInputLevel(counter->pinIndex, level);
+
+    uint8_t data[MM_CH_BUFFER_SIZE_NOTIFY] = {0};
+    data[0] = counter->pinIndex;
+    memcpy(&data[1], &rises, 4);
+    memcpy(&data[5], &gateLength, 4);
+    memcpy(&data[9], &period, 4);
+    memcpy(&data[13], &duty, 2);
+    data[MBIT_MORE_DATA_FORMAT_INDEX] = MbitMoreDataFormat::PIN_COUNT;
+#if MBIT_MORE_USE_SERIAL
+    if (serialConnected) {
+      serialService->notifyOnSerial(0x0110, data, MM_CH_BUFFER_SIZE_NOTIFY);
+      continue;
+    }
+#endif // MBIT_MORE_USE_SERIAL
+    memcpy(moreService->pinEventChBuffer, data, MM_CH_BUFFER_SIZE_NOTIFY);
+    moreService->notifyPinEvent();
+  }
+}
+
+/**
+ * @brief Send a gesture event to the host.
+ * 
+ * @param evt event which has gesture states.
+ */
+void MbitMoreDevice::sendGestureEvent(MicroBitEvent evt) {
   uint8_t *data = moreService->actionEventChBuffer;
   data[0] = MbitMoreActionEvent::GESTURE;
   // Event ID send as uint8_t.
   // MICROBIT_ACCELEROMETER_EVT_TILT_UP, MICROBIT_ACCELEROMETER_EVT_FACE_UP, etc.
   data[1] = (uint8_t)evt.value;
-  // Timestamp of the event send as uint32_t little-endian.
-  // downcast from uint64_t value.
-  uint32_t timestamp = (uint32_t)evt.timestamp;
-  memcpy(&(data[2]), &timestamp, 4);
+  // Timestamp of the event send as uint32_t or uint64_t little-endian.
+  putEventTimestamp(&(data[2]), evt);
   data[MBIT_MORE_DATA_FORMAT_INDEX] = MbitMoreDataFormat::ACTION_EVENT;
 #if MBIT_MORE_USE_SERIAL
   if (serialConnected) {
@@ -1009,6 +2030,71 @@ void MbitMoreDevice::onGestureChanged(MicroBitEvent evt) {
   moreService->notifyActionEvent();
 }
 
+/**
+ * @brief Restore the compass calibration from the storage.
+ *
+ * @return true the calibration was restored
+ * @return false no calibration was stored
+ */
+bool MbitMoreDevice::restoreCompassCalibration() {
+  KeyValuePair *stored = uBit.storage.get(MBIT_MORE_COMPASS_CALIBRATION_KEY);
+  if (stored == NULL)
+    return false;
+  CompassCalibration calibration;
+  memcpy(&calibration, stored->value, sizeof(CompassCalibration));
+  delete stored;
+  uBit.compass.setCalibration(calibration);
+  return true;
+}
+
+/**
+ * @brief Calibrate the compass and store the calibration.
+ * Calibration is interactive on the LED and blocks the fiber until finished.
+ *
+ */
+void MbitMoreDevice::calibrateCompass() {
+  static_assert(sizeof(CompassCalibration) <= sizeof(((KeyValuePair *)0)->value),
+                "compass calibration does not fit the storage");
+  uBit.compass.clearCalibration();
+  uBit.compass.calibrate();
+  if (!uBit.compass.isCalibrated())
+    return;
+  CompassCalibration calibration = uBit.compass.getCalibration();
+  uBit.storage.put(MBIT_MORE_COMPASS_CALIBRATION_KEY, (uint8_t *)&calibration, sizeof(CompassCalibration));
+}
+
+/**
+ * @brief Store whether the radio is enabled at start.
+ * The setting takes effect at the next start. It is not written again when
+ * it is not changed to save the flash.
+ *
+ * @param onStart true to enable the radio at start
+ */
+void MbitMoreDevice::setRadioOnStart(bool onStart) {
+  if (onStart == isRadioOnStart())
+    return;
+  if (onStart) {
+    uint8_t value = 1;
+    uBit.storage.put(MBIT_MORE_RADIO_ON_START_KEY, &value, 1);
+  } else {
+    uBit.storage.remove(MBIT_MORE_RADIO_ON_START_KEY);
+  }
+}
+
+/**
+ * @brief Whether the radio is enabled at start by the stored setting.
+ *
+ * @return true the radio-on-start setting is stored
+ */
+bool MbitMoreDevice::isRadioOnStart() {
+  KeyValuePair *stored = uBit.storage.get(MBIT_MORE_RADIO_ON_START_KEY);
+  if (stored == NULL)
+    return false;
+  bool onStart = (stored->value[0] == 1);
+  delete stored;
+  return onStart;
+}
+
 /**
  * @brief Normalize angle when upside down.
  * 
@@ -1074,9 +2160,598 @@ void MbitMoreDevice::setPullMode(int pinIndex, MbitMorePullMode pull) {
  * @param value digital value [0 | 1]
  */
 void MbitMoreDevice::setDigitalValue(int pinIndex, int value) {
+  releasePinInput(pinIndex);
   uBit.io.pin[pinIndex].setDigitalValue(value);
 }
 
+/**
+ * @brief Stop reporting the pin as an input because it is going to be an output.
+ * Levels of the pin are not sent as events and its counter is stopped.
+ * Pins out of the GPIO table are ignored.
+ * 
+ * @param pinIndex index in edge pins
+ */
+void MbitMoreDevice::releasePinInput(int pinIndex) {
+  if (!isGpio(pinIndex))
+    return;
+  eventInputs &= ~(1 << pinIndex);
+  if (pinIndex < 3) {
+    eventInputs &= ~(1 << (MbitMoreButtonStateIndex::P0 + pinIndex));
+  }
+  stopPinCounter(pinIndex);
+}
+
+/**
+ * @brief Process a command about the output sequence.
+ * SEQUENCE_ADD has steps of [0..3] offset [us] as uint32_t, [4] pin index, [5] action
+ * and [6..7] value as uint16_t little-endian after the command byte.
+ * Steps are added only when all of them are in order of the offset after the steps
+ * already added, and no two steps have the same offset on a pin.
+ * SEQUENCE_PLAY has [1] number of loops (0 is endless) and optional [2..5] period [us] as uint32_t.
+ * The period defaults to the last offset plus the interval between the last two steps.
+ * 
+ * @param data command
+ * @param length length of the command
+ */
+void MbitMoreDevice::onSequenceCommand(uint8_t *data, size_t length) {
+  const int sequenceCommand = data[0] & 0b11111;
+  if (sequenceCommand == MbitMoreSequenceCommand::SEQUENCE_CLEAR) {
+    sequencePlaying = false;
+    sequenceLength = 0;
+  } else if (sequenceCommand == MbitMoreSequenceCommand::SEQUENCE_ADD) {
+    if (!isSequenceInOrder(data, length))
+      return;
+    for (size_t offset = 1; offset + MBIT_MORE_SEQUENCE_STEP_SIZE <= length; offset += MBIT_MORE_SEQUENCE_STEP_SIZE) {
+      if (sequenceLength >= MBIT_MORE_SEQUENCE_SIZE)
+        return;
+      if (!isGpio(data[offset + 4]))
+        continue;
+      MbitMoreSequenceStep *step = &sequenceSteps[sequenceLength];
+      memcpy(&step->offset, &data[offset], 4);
+      step->pinIndex = data[offset + 4];
+      step->action = data[offset + 5];
+      memcpy(&step->value, &data[offset + 6], 2);
+      // Publish the step after it was written for the playing fiber.
+      sequenceLength = sequenceLength + 1;
+    }
+  } else if (sequenceCommand == MbitMoreSequenceCommand::SEQUENCE_PLAY) {
+    if (sequenceLength == 0)
+      return;
+    sequenceLoops = (length >= 2) ? data[1] : 1;
+    sequencePeriod = 0;
+    if (length >= 6) {
+      memcpy(&sequencePeriod, &data[2], 4);
+    }
+    sequenceRestart = true;
+    sequencePlaying = true;
+    if (!sequenceFiberRunning) {
+      sequenceFiberRunning = true;
+      create_fiber(playMbitMoreSequence);
+    }
+  } else if (sequenceCommand == MbitMoreSequenceCommand::SEQUENCE_STOP) {
+    sequencePlaying = false;
+  }
+  // The playing fiber notices the change at once, not at the next step.
+  wakeSequence();
+}
+
+/**
+ * @brief Whether the steps in SEQUENCE_ADD can be appended to the sequence.
+ * Offsets must not go back from the last step, and steps on the same pin must not
+ * overlap at an offset, because the playing fiber runs steps in order.
+ * 
+ * @param data command
+ * @param length length of the command
+ * @return true the steps are in order
+ * @return false a step is out of order or overlaps another step
+ */
+bool MbitMoreDevice::isSequenceInOrder(uint8_t *data, size_t length) {
+  size_t count = sequenceLength;
+  const size_t added = (length > 0) ? ((length - 1) / MBIT_MORE_SEQUENCE_STEP_SIZE) : 0;
+  for (size_t i = 0; i < added; i++) {
+    uint8_t *stepData = &data[1 + (i * MBIT_MORE_SEQUENCE_STEP_SIZE)];
+    uint32_t offset;
+    memcpy(&offset, stepData, 4);
+    uint8_t pinIndex = stepData[4];
+    // Steps before this in the sequence and in the command.
+    for (size_t j = count + i; j > 0; j--) {
+      uint32_t previousOffset;
+      uint8_t previousPin;
+      if (j > count) {
+        uint8_t *previousData = &data[1 + ((j - 1 - count) * MBIT_MORE_SEQUENCE_STEP_SIZE)];
+        memcpy(&previousOffset, previousData, 4);
+        previousPin = previousData[4];
+      } else {
+        previousOffset = sequenceSteps[j - 1].offset;
+        previousPin = sequenceSteps[j - 1].pinIndex;
+      }
+      if (offset < previousOffset)
+        return false;
+      if (offset > previousOffset)
+        break;
+      if (pinIndex == previousPin)
+        return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Play the output sequence until the end or stopped.
+ * Times of steps are counted from the start of each loop which is advanced by the period,
+ * so that errors of steps are not accumulated over loops.
+ * 
+ */
+void MbitMoreDevice::playSequence() {
+  uint32_t startedAt = 0;
+  size_t index = 0;
+  uint8_t loopsDone = 0;
+  while (sequencePlaying) {
+    if (sequenceRestart) {
+      sequenceRestart = false;
+      startedAt = (uint32_t)system_timer_current_time_us();
+      index = 0;
+      loopsDone = 0;
+    }
+    if (index >= sequenceLength) {
+      loopsDone++;
+      if (sequenceLoops != 0 && loopsDone >= sequenceLoops)
+        break;
+      uint32_t period = sequencePeriod;
+      if (period == 0 && sequenceLength > 0) {
+        // Next loop starts one step interval after the last step not to run both at once.
+        uint32_t last = sequenceSteps[sequenceLength - 1].offset;
+        uint32_t previous = (sequenceLength > 1) ? sequenceSteps[sequenceLength - 2].offset : 0;
+        period = last + (last - previous);
+      }
+      if (period == 0)
+        break; // Loops of no length would never yield.
+      startedAt += period;
+      index = 0;
+      continue;
+    }
+    MbitMoreSequenceStep *step = &sequenceSteps[index];
+    if (!waitSequenceUntil(startedAt + step->offset))
+      continue;
+    runSequenceStep(step);
+    index++;
+  }
+  sequencePlaying = false;
+  sequenceFiberRunning = false;
+}
+
+/**
+ * @brief Wait until the time of a step.
+ * The fiber sleeps while the step is far, waits for a timer event within the tick
+ * of the scheduler not to overshoot, and spins on the timer only for the last
+ * MBIT_MORE_SEQUENCE_SPIN_TIME to step in [us].
+ * Steps which are already late are run immediately.
+ * 
+ * @param target time of the step [us]
+ * @return true the time has come
+ * @return false the sequence was stopped or restarted while waiting
+ */
+bool MbitMoreDevice::waitSequenceUntil(uint32_t target) {
+  while (true) {
+    if (!sequencePlaying || sequenceRestart)
+      return false;
+    int32_t remaining = (int32_t)(target - (uint32_t)system_timer_current_time_us());
+    if (remaining <= 0)
+      return true;
+    if (remaining >= MBIT_MORE_SEQUENCE_TICK_TIME + 1000) {
+      fiber_sleep((remaining - MBIT_MORE_SEQUENCE_TICK_TIME) / 1000);
+      continue;
+    }
+    if (remaining > MBIT_MORE_SEQUENCE_SPIN_TIME) {
+      // Sleeping in ticks would overshoot, then a timer wakes the fiber just before the step.
+      fiber_wake_on_event(MBIT_MORE_SEQUENCE_ID, MBIT_MORE_SEQUENCE_WAKE);
+      sequenceWaiting = true;
+#if MICROBIT_CODAL
+      system_timer_event_after_us(remaining - MBIT_MORE_SEQUENCE_SPIN_TIME, MBIT_MORE_SEQUENCE_ID, MBIT_MORE_SEQUENCE_WAKE);
+#else // NOT MICROBIT_CODAL
+      sequenceTimeout.attach_us(wakeMbitMoreSequence, remaining - MBIT_MORE_SEQUENCE_SPIN_TIME);
+#endif // NOT MICROBIT_CODAL
+      schedule();
+      sequenceWaiting = false;
+      // The timer is left when the fiber was woken by a command.
+#if MICROBIT_CODAL
+      system_timer_cancel_event(MBIT_MORE_SEQUENCE_ID, MBIT_MORE_SEQUENCE_WAKE);
+#else // NOT MICROBIT_CODAL
+      sequenceTimeout.detach();
+#endif // NOT MICROBIT_CODAL
+      continue;
+    }
+    while ((int32_t)(target - (uint32_t)system_timer_current_time_us()) > 0)
+      ;
+    return true;
+  }
+}
+
+/**
+ * @brief Wake the fiber playing the sequence if it is waiting.
+ * This may be called in an interrupt.
+ * 
+ */
+void MbitMoreDevice::wakeSequence() {
+  if (!sequenceWaiting)
+    return;
+  sequenceWaiting = false;
+  MicroBitEvent(MBIT_MORE_SEQUENCE_ID, MBIT_MORE_SEQUENCE_WAKE);
+}
+
+/**
+ * @brief Run the action of the step.
+ * 
+ * @param step step to run
+ */
+void MbitMoreDevice::runSequenceStep(MbitMoreSequenceStep *step) {
+  if (step->action == MbitMoreSequenceAction::STEP_DIGITAL) {
+    setDigitalValue(step->pinIndex, step->value ? 1 : 0);
+  } else if (step->action == MbitMoreSequenceAction::STEP_PWM) {
+    setAnalogValue(step->pinIndex, step->value);
+  } else if (step->action == MbitMoreSequenceAction::STEP_SERVO) {
+    releasePinInput(step->pinIndex);
+    uBit.io.pin[step->pinIndex].setServoValue(step->value);
+  }
+}
+
+/**
+ * @brief Set an event-action rule.
+ * Command has [1] index of the rule, [2] MbitMoreRuleTrigger, [3] source of the trigger,
+ * [4..5] event ID or threshold as uint16_t, [6] MbitMoreRuleAction, [7] pin index or volume
+ * and [8..11] value of the action as uint32_t little-endian.
+ * Bits of LEDs for ACTION_DISPLAY are x + (5 * y).
+ * 
+ * @param data command
+ * @param length length of the command
+ */
+void MbitMoreDevice::setRule(uint8_t *data, size_t length) {
+  if (length < 3 || data[1] >= MBIT_MORE_RULE_SLOTS)
+    return;
+  MbitMoreRule *rule = &rules[data[1]];
+  // Disable the rule while it is rewritten because listeners may read it.
+  rule->trigger = MbitMoreRuleTrigger::RULE_NONE;
+  if (data[2] == MbitMoreRuleTrigger::RULE_NONE || length < 12)
+    return;
+  MbitMoreRule updated;
+  updated.source = data[3];
+  memcpy(&updated.value, &data[4], 2);
+  updated.action = data[6];
+  updated.target = data[7];
+  memcpy(&updated.actionValue, &data[8], 4);
+  updated.above = 0;
+  if ((updated.action == MbitMoreRuleAction::ACTION_DIGITAL || updated.action == MbitMoreRuleAction::ACTION_PWM) && !isGpio(updated.target))
+    return;
+  if (data[2] == MbitMoreRuleTrigger::RULE_ABOVE || data[2] == MbitMoreRuleTrigger::RULE_BELOW) {
+    // Analog inputs are P0, P1 and P2.
+    if (updated.source > 2)
+      return;
+    updated.above = (uBit.io.pin[updated.source].getAnalogValue() >= updated.value) ? 1 : 0;
+  }
+  // Listeners in interrupts see the rule only after all fields are written.
+#if MICROBIT_CODAL
+  target_disable_irq();
+#else // NOT MICROBIT_CODAL
+  __disable_irq();
+#endif // NOT MICROBIT_CODAL
+  rule->source = updated.source;
+  rule->value = updated.value;
+  rule->action = updated.action;
+  rule->target = updated.target;
+  rule->actionValue = updated.actionValue;
+  rule->above = updated.above;
+  rule->trigger = data[2];
+#if MICROBIT_CODAL
+  target_enable_irq();
+#else // NOT MICROBIT_CODAL
+  __enable_irq();
+#endif // NOT MICROBIT_CODAL
+  requestEventTicking();
+}
+
+/**
+ * @brief Run actions of the rules which are triggered by the event.
+ * This is called in the listeners which may be in an interrupt.
+ * Digital outputs are written here to react without delay,
+ * other actions are passed to the fiber through the event ring.
+ * 
+ * @param trigger MbitMoreRuleTrigger of the event
+ * @param source pin index or MbitMoreEventMaskSource of the event
+ * @param evt event which triggers
+ */
+void MbitMoreDevice::triggerRules(int trigger, int source, MicroBitEvent &evt) {
+  for (size_t i = 0; i < MBIT_MORE_RULE_SLOTS; i++) {
+    MbitMoreRule *rule = &rules[i];
+    if (rule->trigger != trigger || rule->value != evt.value)
+      continue;
+    if (trigger != MbitMoreRuleTrigger::RULE_GESTURE && rule->source != source)
+      continue;
+    if (rule->action == MbitMoreRuleAction::ACTION_DIGITAL && writeDigitalOutput(rule->target, rule->actionValue ? 1 : 0))
+      continue;
+    MicroBitEvent ruleEvent = evt;
+    ruleEvent.source = i;
+    enqueueEvent(MbitMoreEventKind::EVENT_RULE, ruleEvent);
+  }
+}
+
+/**
+ * @brief Run actions of the rules whose analog value crossed the threshold.
+ * This is polled by the fiber sending events while the ticking fiber wakes it,
+ * and samples at most once in MBIT_MORE_RULE_SAMPLE_INTERVAL.
+ * A value read by the state update in the interval is used instead of sampling again.
+ * A rule whose pin is no longer an analog input is disabled and reported to the host,
+ * because sampling would change the mode of the pin.
+ * 
+ */
+void MbitMoreDevice::checkRuleThresholds() {
+  uint32_t now = (uint32_t)system_timer_current_time();
+  if ((now - ruleThresholdsCheckedAt) < MBIT_MORE_RULE_SAMPLE_INTERVAL)
+    return;
+  ruleThresholdsCheckedAt = now;
+  for (size_t i = 0; i < MBIT_MORE_RULE_SLOTS; i++) {
+    MbitMoreRule *rule = &rules[i];
+    if (rule->trigger != MbitMoreRuleTrigger::RULE_ABOVE && rule->trigger != MbitMoreRuleTrigger::RULE_BELOW)
+      continue;
+    int pinIndex = rule->source;
+    if (!(uBit.io.pin[pinIndex].isAnalog() && uBit.io.pin[pinIndex].isInput())) {
+      int trigger = rule->trigger;
+      rule->trigger = MbitMoreRuleTrigger::RULE_NONE;
+      sendRuleDisabled(i, trigger, pinIndex);
+      continue;
+    }
+    if ((now - analogInReadAt[pinIndex]) >= MBIT_MORE_RULE_SAMPLE_INTERVAL) {
+      analogInValues[pinIndex] = uBit.io.pin[pinIndex].getAnalogValue();
+      analogInReadAt[pinIndex] = now;
+    }
+    uint8_t above = (analogInValues[pinIndex] >= rule->value) ? 1 : 0;
+    if (above == rule->above)
+      continue;
+    rule->above = above;
+    if (above == (rule->trigger == MbitMoreRuleTrigger::RULE_ABOVE ? 1 : 0)) {
+      runRuleAction(rule);
+    }
+  }
+}
+
+/**
+ * @brief Send to the host that the rule was disabled.
+ * Data has [1] index of the rule, [2] trigger and [3] pin index which the rule had,
+ * and [4..] time when it was disabled in the same format as timestamps of events.
+ * 
+ * @param index index of the rule
+ * @param trigger MbitMoreRuleTrigger which the rule had
+ * @param source pin index of the trigger
+ */
+void MbitMoreDevice::sendRuleDisabled(int index, int trigger, int source) {
+  uint8_t data[MM_CH_BUFFER_SIZE_NOTIFY] = {0};
+  MicroBitEvent disabledAt;
+#if MICROBIT_CODAL
+  disabledAt.timestamp = system_timer_current_time_us();
+#else // NOT MICROBIT_CODAL
+  disabledAt.timestamp = system_timer_current_time();
+#endif // NOT MICROBIT_CODAL
+  data[0] = MbitMoreActionEvent::RULE_DISABLED;
+  data[1] = (uint8_t)index;
+  data[2] = (uint8_t)trigger;
+  data[3] = (uint8_t)source;
+  putEventTimestamp(&data[4], disabledAt);
+  data[MBIT_MORE_DATA_FORMAT_INDEX] = MbitMoreDataFormat::ACTION_EVENT;
+#if MBIT_MORE_USE_SERIAL
+  if (serialConnected) {
+    serialService->notifyOnSerial(0x0111, data, MM_CH_BUFFER_SIZE_NOTIFY);
+    return;
+  }
+#endif // MBIT_MORE_USE_SERIAL
+  memcpy(moreService->actionEventChBuffer, data, MM_CH_BUFFER_SIZE_NOTIFY);
+  moreService->notifyActionEvent();
+}
+
+/**
+ * @brief Run the action of the rule.
+ * 
+ * @param rule rule to run
+ */
+void MbitMoreDevice::runRuleAction(MbitMoreRule *rule) {
+  if (rule->action == MbitMoreRuleAction::ACTION_DIGITAL) {
+    setDigitalValue(rule->target, rule->actionValue ? 1 : 0);
+  } else if (rule->action == MbitMoreRuleAction::ACTION_PWM) {
+    setAnalogValue(rule->target, rule->actionValue);
+  } else if (rule->action == MbitMoreRuleAction::ACTION_TONE) {
+    playTone(rule->actionValue, rule->target);
+  } else if (rule->action == MbitMoreRuleAction::ACTION_DISPLAY) {
+    uBit.display.stopAnimation();
+    for (size_t y = 0; y < 5; y++) {
+      for (size_t x = 0; x < 5; x++) {
+        uBit.display.image.setPixelValue(x, y, (rule->actionValue & (1 << (x + (5 * y)))) ? 255 : 0);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Write the level on the pin with the GPIO register if it is a digital output.
+ * This is safe in an interrupt because it does not change the configuration of the pin.
+ * 
+ * @param pinIndex index in edge pins
+ * @param value digital value [0 | 1]
+ * @return true the level was written
+ * @return false the pin is not a digital output
+ */
+bool MbitMoreDevice::writeDigitalOutput(int pinIndex, int value) {
+  if (!(uBit.io.pin[pinIndex].isDigital() && uBit.io.pin[pinIndex].isOutput()))
+    return false;
+  int name = uBit.io.pin[pinIndex].name;
+  uint32_t bit = 1 << (name & 0x1F);
+#if MICROBIT_CODAL
+  NRF_GPIO_Type *port = (name >> 5) ? NRF_P1 : NRF_P0;
+#else // NOT MICROBIT_CODAL
+  NRF_GPIO_Type *port = NRF_GPIO;
+#endif // NOT MICROBIT_CODAL
+  if (value) {
+    port->OUTSET = bit;
+  } else {
+    port->OUTCLR = bit;
+  }
+  return true;
+}
+
+/**
+ * @brief Set the values on the pins in the mask as digital output at once.
+ * Pins are made to output with their current latch, then OUT register of each port
+ * is written once, so that all edges on a port happen together.
+ * P16 is on another port in micro:bit v2.
+ * 
+ * @param mask bits of pin indexes to set
+ * @param values bits of digital values
+ */
+void MbitMoreDevice::setDigitalValues(uint32_t mask, uint32_t values) {
+#if MICROBIT_CODAL
+  NRF_GPIO_Type *ports[2] = {NRF_P0, NRF_P1};
+#else // NOT MICROBIT_CODAL
+  NRF_GPIO_Type *ports[1] = {NRF_GPIO};
+#endif // NOT MICROBIT_CODAL
+  const size_t portCount = sizeof(ports) / sizeof(ports[0]);
+  uint32_t setBits[portCount] = {0};
+  uint32_t changeBits[portCount] = {0};
+  for (size_t i = 0; i < (sizeof(gpioPin) / sizeof(gpioPin[0])); i++) {
+    int pinIndex = gpioPin[i];
+    if (!(mask & (1 << pinIndex)))
+      continue;
+    size_t port = uBit.io.pin[pinIndex].name >> 5;
+    if (port >= portCount)
+      continue;
+    uint32_t bit = 1 << (uBit.io.pin[pinIndex].name & 0x1F);
+    releasePinInput(pinIndex);
+    if (!(uBit.io.pin[pinIndex].isDigital() && uBit.io.pin[pinIndex].isOutput())) {
+#if MICROBIT_CODAL
+      // workaround to set d-out from touch-mode in microbit-codal-v2
+      if (pinIndex < 3 && touchMode[pinIndex]) {
+        uBit.io.pin[pinIndex].setAnalogValue(0);
+      }
+#endif // MICROBIT_CODAL
+      setDigitalValue(pinIndex, (ports[port]->OUT & bit) ? 1 : 0);
+    }
+    if (pinIndex < 3) {
+      touchMode[pinIndex] = false;
+    }
+    changeBits[port] |= bit;
+    if (values & (1 << pinIndex)) {
+      setBits[port] |= bit;
+    }
+  }
+#if MICROBIT_CODAL
+  target_disable_irq();
+#else // NOT MICROBIT_CODAL
+  __disable_irq();
+#endif // NOT MICROBIT_CODAL
+  for (size_t port = 0; port < portCount; port++) {
+    if (changeBits[port] == 0)
+      continue;
+    ports[port]->OUT = (ports[port]->OUT & ~changeBits[port]) | setBits[port];
+  }
+#if MICROBIT_CODAL
+  target_enable_irq();
+#else // NOT MICROBIT_CODAL
+  __enable_irq();
+#endif // NOT MICROBIT_CODAL
+}
+
+/**
+ * @brief Read the values on the pins in the mask as digital input at once.
+ * Digital outputs are read from OUT register to keep driving them. PWM and
+ * servo outputs have no digital value and are removed from the mask.
+ * Other pins which are not digital input are made to input as getDigitalValue(),
+ * then IN register of each port is read once to take a snapshot of all pins.
+ * 
+ * @param mask bits of pin indexes to read, and the pins read at return
+ * @return uint32_t bits of digital values
+ */
+uint32_t MbitMoreDevice::getDigitalValues(uint32_t &mask) {
+#if MICROBIT_CODAL
+  NRF_GPIO_Type *ports[2] = {NRF_P0, NRF_P1};
+#else // NOT MICROBIT_CODAL
+  NRF_GPIO_Type *ports[1] = {NRF_GPIO};
+#endif // NOT MICROBIT_CODAL
+  const size_t portCount = sizeof(ports) / sizeof(ports[0]);
+  uint32_t readMask = 0;
+  uint32_t outputMask = 0;
+  for (size_t i = 0; i < (sizeof(gpioPin) / sizeof(gpioPin[0])); i++) {
+    int pinIndex = gpioPin[i];
+    if (!(mask & (1 << pinIndex)))
+      continue;
+    // Pins listening events are already digital input.
+    if (eventInputs & (1 << pinIndex)) {
+      readMask |= (1 << pinIndex);
+      continue;
+    }
+    if (uBit.io.pin[pinIndex].isOutput()) {
+      if (uBit.io.pin[pinIndex].isDigital()) {
+        readMask |= (1 << pinIndex);
+        outputMask |= (1 << pinIndex);
+      }
+      continue;
+    }
+    if (!(uBit.io.pin[pinIndex].isDigital() && uBit.io.pin[pinIndex].isInput())) {
+      uBit.io.pin[pinIndex].getDigitalValue();
+    }
+    readMask |= (1 << pinIndex);
+  }
+  uint32_t portLevels[portCount];
+  uint32_t portOutputs[portCount];
+  for (size_t port = 0; port < portCount; port++) {
+    portLevels[port] = ports[port]->IN;
+    portOutputs[port] = ports[port]->OUT;
+  }
+  uint32_t values = 0;
+  for (size_t i = 0; i < (sizeof(gpioPin) / sizeof(gpioPin[0])); i++) {
+    int pinIndex = gpioPin[i];
+    if (!(readMask & (1 << pinIndex)))
+      continue;
+    size_t port = uBit.io.pin[pinIndex].name >> 5;
+    if (port >= portCount) {
+      readMask &= ~(1 << pinIndex);
+      continue;
+    }
+    uint32_t levels = (outputMask & (1 << pinIndex)) ? portOutputs[port] : portLevels[port];
+    if (levels & (1 << (uBit.io.pin[pinIndex].name & 0x1F))) {
+      values |= (1 << pinIndex);
+    }
+  }
+  mask = readMask;
+  return values;
+}
+
+/**
+ * @brief Send digital values of the pins in the mask to the host.
+ * Data has [0..3] mask of the pins read and [4..7] values which have a bit for each pin index,
+ * and [8..] time when they were read in the same format as timestamps of events.
+ * 
+ * @param mask bits of pin indexes to read
+ */
+void MbitMoreDevice::sendDigitalValues(uint32_t mask) {
+  uint8_t data[MM_CH_BUFFER_SIZE_NOTIFY] = {0};
+  uint32_t values = getDigitalValues(mask);
+  // Time of reading is stamped as an event to be in the same clock as other events.
+  MicroBitEvent readAt;
+#if MICROBIT_CODAL
+  readAt.timestamp = system_timer_current_time_us();
+#else // NOT MICROBIT_CODAL
+  readAt.timestamp = system_timer_current_time();
+#endif // NOT MICROBIT_CODAL
+  memcpy(&data[0], &mask, 4);
+  memcpy(&data[4], &values, 4);
+  putEventTimestamp(&data[8], readAt);
+  data[MBIT_MORE_DATA_FORMAT_INDEX] = MbitMoreDataFormat::PIN_INPUTS;
+#if MBIT_MORE_USE_SERIAL
+  if (serialConnected) {
+    serialService->notifyOnSerial(0x0110, data, MM_CH_BUFFER_SIZE_NOTIFY);
+    return;
+  }
+#endif // MBIT_MORE_USE_SERIAL
+  memcpy(moreService->pinEventChBuffer, data, MM_CH_BUFFER_SIZE_NOTIFY);
+  moreService->notifyPinEvent();
+}
+
 /**
  * @brief Set the value on the pin as analog output (PWM).
  * 
@@ -1091,6 +2766,7 @@ void MbitMoreDevice::setAnalogValue(int pinIndex, int value) {
   // stable level is 0 .. 1021 in micro:bit v1.5,
   int validValue = value > 1021 ? 1021 : value;
 #endif // NOT MICROBIT_CODAL
+  releasePinInput(pinIndex);
   uBit.io.pin[pinIndex].setAnalogValue(validValue);
 }
 
@@ -1104,6 +2780,7 @@ void MbitMoreDevice::setAnalogValue(int pinIndex, int value) {
  */
 void MbitMoreDevice::setServoValue(int pinIndex, int angle, int range,
                                    int center) {
+  releasePinInput(pinIndex);
   uBit.io.pin[pinIndex].setServoValue(angle, range, center);
 }
 
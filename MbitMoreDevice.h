@@ -33,11 +33,201 @@ using MbitMoreService = MbitMoreServiceDAL;
 #define ANALOG_IN_SAMPLES_SIZE 5
 #endif // NOT MICROBIT_CODAL
 
+/**
+ * @brief Capacity of the ring of events waiting to be sent.
+ */
+#if MICROBIT_CODAL
+#define MBIT_MORE_EVENT_RING_SIZE 32
+#else // NOT MICROBIT_CODAL
+#define MBIT_MORE_EVENT_RING_SIZE 16
+#endif // NOT MICROBIT_CODAL
+
+/**
+ * @brief Component ID of the event which wakes the fiber sending events.
+ */
+#define MBIT_MORE_EVENT_SENDING_ID 8001
+
+/**
+ * @brief Event value to wake the fiber sending events.
+ */
+#define MBIT_MORE_EVENT_SENDING_WAKE 1
+
+/**
+ * @brief Interval of waking the fiber sending events while pin counters or thresholds are in use [ms].
+ */
+#define MBIT_MORE_EVENT_POLL_INTERVAL 10
+
+/**
+ * @brief Capacity of the ring of captured edges.
+ */
+#if MICROBIT_CODAL
+#define MBIT_MORE_CAPTURE_RING_SIZE 64
+#else // NOT MICROBIT_CODAL
+#define MBIT_MORE_CAPTURE_RING_SIZE 16
+#endif // NOT MICROBIT_CODAL
+
+/**
+ * @brief Edge of a pin which was captured.
+ */
+typedef struct {
+  uint8_t pinIndex; /** index of the pin */
+  uint8_t level;    /** level after the edge */
+  uint32_t time;    /** time of the edge [us] */
+} MbitMoreEdgeRecord;
+
+/**
+ * @brief Number of pins which can count edges at the same time.
+ */
+#define MBIT_MORE_PIN_COUNTER_SLOTS 4
+
+/**
+ * @brief Default gate time of pin counters [ms].
+ */
+#define MBIT_MORE_PIN_COUNTER_GATE_TIME 1000
+
+/**
+ * @brief Min gate time of pin counters [ms].
+ */
+#define MBIT_MORE_PIN_COUNTER_MIN_GATE_TIME 10
+
+/**
+ * @brief Counter of edges on a pin in a gate time.
+ * Members which are marked as volatile are written by the listener.
+ */
+typedef struct {
+  uint8_t pinIndex;            /** index of the pin or 0xFF when not used */
+  volatile uint8_t level;      /** level after the last edge */
+  uint16_t gateTime;           /** gate time [ms] */
+  uint32_t gateStartedAt;      /** time when the gate was opened [us] */
+  volatile uint32_t rises;     /** count of rising edges in the gate */
+  volatile uint32_t firstRise; /** time of the first rising edge in the gate [us] */
+  volatile uint32_t lastRise;  /** time of the last rising edge in the gate [us] */
+  volatile uint32_t lastEdge;  /** time of the last edge [us] */
+  volatile uint32_t highTime;  /** total time of high level in the gate [us] */
+} MbitMorePinCounter;
+
+/**
+ * @brief Capacity of steps in the output sequence.
+ */
+#if MICROBIT_CODAL
+#define MBIT_MORE_SEQUENCE_SIZE 64
+#else // NOT MICROBIT_CODAL
+#define MBIT_MORE_SEQUENCE_SIZE 16
+#endif // NOT MICROBIT_CODAL
+
+/**
+ * @brief Size of a step in the command [byte].
+ */
+#define MBIT_MORE_SEQUENCE_STEP_SIZE 8
+
+/**
+ * @brief Time before a step to stop sleeping in ticks and wait for a timer [us].
+ * It covers the tick of the scheduler.
+ */
+#if MICROBIT_CODAL
+#define MBIT_MORE_SEQUENCE_TICK_TIME 2000
+#else // NOT MICROBIT_CODAL
+#define MBIT_MORE_SEQUENCE_TICK_TIME 7000
+#endif // NOT MICROBIT_CODAL
+
+/**
+ * @brief Time before a step to be woken by the timer and spin for the precise timing [us].
+ * It covers the latency to switch to the fiber.
+ */
+#define MBIT_MORE_SEQUENCE_SPIN_TIME 200
+
+/**
+ * @brief Component ID of the event which wakes the fiber playing the sequence.
+ */
+#define MBIT_MORE_SEQUENCE_ID 8002
+
+/**
+ * @brief Event value to wake the fiber playing the sequence.
+ */
+#define MBIT_MORE_SEQUENCE_WAKE 1
+
+/**
+ * @brief Step of the output sequence.
+ */
+typedef struct {
+  uint32_t offset;  /** time from the start of the loop [us] */
+  uint8_t pinIndex; /** index of the pin */
+  uint8_t action;   /** MbitMoreSequenceAction */
+  uint16_t value;   /** value of the action */
+} MbitMoreSequenceStep;
+
+/**
+ * @brief Number of event-action rules.
+ */
+#define MBIT_MORE_RULE_SLOTS 8
+
+/**
+ * @brief Interval of checking thresholds of rules [ms].
+ */
+#define MBIT_MORE_RULE_SAMPLE_INTERVAL 20
+
+/**
+ * @brief Event-action rule which runs on this micro:bit.
+ */
+typedef struct {
+  volatile uint8_t trigger; /** MbitMoreRuleTrigger, written last to publish the rule */
+  uint8_t source;       /** pin index or MbitMoreEventMaskSource of the trigger */
+  uint16_t value;       /** event ID or threshold of the trigger */
+  uint8_t action;       /** MbitMoreRuleAction */
+  uint8_t target;       /** pin index or volume of the action */
+  uint8_t above;        /** whether the analog value was above the threshold */
+  uint32_t actionValue; /** level, PWM value, period of tone [us] or bits of LEDs */
+} MbitMoreRule;
+
+/**
+ * @brief Kind of events in the ring.
+ */
+enum MbitMoreEventKind
+{
+  EVENT_PIN = 0,
+  EVENT_BUTTON = 1,
+  EVENT_GESTURE = 2,
+  EVENT_BUTTON_LEVEL = 3, // masked button event which only changes the state
+  EVENT_PIN_LEVEL = 4,    // masked pin event which only changes the state
+  EVENT_RULE = 5          // action of a rule whose source is the index of the rule
+};
+
+/**
+ * @brief Number of sources in MbitMoreEventMaskSource.
+ */
+#define MBIT_MORE_EVENT_MASK_SOURCES 8
+
+/**
+ * @brief Event which is waiting to be sent.
+ */
+typedef struct {
+  uint8_t kind;       /** MbitMoreEventKind */
+  uint16_t source;    /** component ID of the event */
+  uint16_t value;     /** event ID */
+  uint64_t timestamp; /** timestamp of the event */
+} MbitMoreEventRecord;
+
+/**
+ * @brief Default min interval to send state on input changes [ms].
+ */
+#define MBIT_MORE_STATE_PUSH_INTERVAL 10
+
+/**
+ * @brief Key of the compass calibration in the storage.
+ */
+#define MBIT_MORE_COMPASS_CALIBRATION_KEY "mmCompass"
+
+/**
+ * @brief Key of the radio-on-start setting in the storage.
+ */
+#define MBIT_MORE_RADIO_ON_START_KEY "mmRadio"
+
 #if MICROBIT_CODAL
 #define MBIT_MORE_WAITING_DATA_LABELS_LENGTH 16
 #define MBIT_MORE_WAITING_DATA_LABEL_NOT_FOUND 0xff
 #define MBIT_MORE_DATA_LABEL_SIZE 8
 #define MBIT_MORE_DATA_CONTENT_SIZE 11
+#define MBIT_MORE_RADIO_BRIDGE_LABEL "radio" // label for radio packets without name
 #endif // MICROBIT_CODAL
 
 /**
@@ -139,7 +329,43 @@ public:
 #endif // MBIT_MORE_USE_SERIAL
 
   // ---------------------radio
- MbitMoreRadio *Radio;
+ MbitMoreRadio *Radio = NULL;
+
+  /**
+   * @brief Return the radio and enable it at the first call.
+   *
+   * @return MbitMoreRadio* radio of Microbit More
+   */
+  MbitMoreRadio *radio();
+
+  /**
+   * @brief Return the timestamp of the event in the clock shared by radio.
+   *
+   * @param evt event which has the timestamp
+   * @return uint32_t timestamp downcast from uint64_t value
+   */
+  uint32_t eventTimestamp(MicroBitEvent &evt);
+
+  /**
+   * @brief Whether events are sent with uint64_t timestamp [us] or not.
+   */
+  bool extendedTimestamp = false;
+
+  /**
+   * @brief Put the timestamp of the event in the format selected by the host.
+   *
+   * @param data buffer to put the timestamp
+   * @param evt event which has the timestamp
+   */
+  void putEventTimestamp(uint8_t *data, MicroBitEvent &evt);
+
+  /**
+   * @brief Return the timestamp of the event in [us] since boot.
+   *
+   * @param evt event which has the timestamp
+   * @return uint64_t timestamp [us]
+   */
+  uint64_t eventTimeUs(MicroBitEvent &evt);
 
   /**
    * @brief Whether the serial port communication is started. 
@@ -167,6 +393,71 @@ void onRadioreceived( MicroBitEvent e);
 
   bool touchMode[3] = {false};
 
+  /**
+   * @brief State bitmap of inputs which is maintained by events.
+   * Bits are in the same order as the state data.
+   */
+  uint32_t inputLevels = 0;
+
+  /**
+   * @brief Bits of inputs which are maintained by events in inputLevels.
+   * Other inputs are polled at updating the state.
+   */
+  uint32_t eventInputs = 0;
+
+  /**
+   * @brief Set the level of an input in the state bitmap.
+   *
+   * @param index index of the bit in the state data
+   * @param level level of the input
+   */
+  void setInputLevel(int index, bool level);
+
+  /**
+   * @brief Min interval to send state on input changes [ms], 0 is off.
+   */
+  uint16_t statePushInterval = 0;
+
+  /**
+   * @brief Running time when state was sent on input changes [ms].
+   */
+  uint32_t statePushedAt = 0;
+
+  /**
+   * @brief Whether sending state is waiting for the min interval.
+   */
+  bool statePushScheduled = false;
+
+  /**
+   * @brief Send state now or after the min interval since the last one.
+   *
+   */
+  void requestStatePush();
+
+  /**
+   * @brief Send state after the min interval since the last one.
+   *
+   */
+  void pushStateLater();
+
+  /**
+   * @brief Play the output sequence until the end or stopped.
+   *
+   */
+  void playSequence();
+
+  /**
+   * @brief Wake the fiber playing the sequence if it is waiting.
+   * This may be called in an interrupt.
+   */
+  void wakeSequence();
+
+  /**
+   * @brief Send state with current levels of inputs.
+   *
+   */
+  void pushState();
+
   /**
    * @brief Shadow screen to display on the LED.
    *
@@ -200,6 +491,12 @@ void onRadioreceived( MicroBitEvent e);
    * 
    */
   MbitMoreLabeledData receivedData[MBIT_MORE_WAITING_DATA_LABELS_LENGTH] = {{{0}}};
+
+  /**
+   * @brief Whether received radio packets update the labeled data.
+   * 
+   */
+  bool radioBridge = false;
 #endif // MICROBIT_CODAL
 
   /**
@@ -207,6 +504,16 @@ void onRadioreceived( MicroBitEvent e);
    */
   int analogInSamples[3][ANALOG_IN_SAMPLES_SIZE] = {{0}};
 
+  /**
+   * @brief Last analog values of the pins which are shared with threshold rules.
+   */
+  uint16_t analogInValues[3] = {0};
+
+  /**
+   * @brief Time when the analog values were read [ms].
+   */
+  uint32_t analogInReadAt[3] = {0};
+
 #if MICROBIT_CODAL
   /**
    * @brief On-board microphone is in use or not.
@@ -300,6 +607,13 @@ void onRadioreceived( MicroBitEvent e);
    */
   void updateState(uint8_t *data);
 
+  /**
+   * @brief Return levels of digital inputs as the bits in the state data.
+   *
+   * @return uint32_t levels of digital inputs
+   */
+  uint32_t readDigitalLevels();
+
   /**
    * @brief Update data of motion.
    *
@@ -379,6 +693,24 @@ void onRadioreceived( MicroBitEvent e);
    */
   ManagedString dataContentAsText(int labelID);
 
+  /**
+   * @brief Store content for the label and fire the received event.
+   * 
+   * @param dataLabel label of the data (MBIT_MORE_DATA_LABEL_SIZE chars at most)
+   * @param dataType type of the data
+   * @param content content of the data
+   * @param length length of the content
+   */
+  void receiveLabeledData(const char *dataLabel, MbitMoreDataContentType dataType, const uint8_t *content, size_t length);
+
+  /**
+   * @brief Update labeled data with the content of a radio packet.
+   * 
+   * @param packet radio packet received
+   * @param length length of the packet
+   */
+  void bridgeRadioPacket(const uint8_t *packet, size_t length);
+
   /**
    * @brief Send number with label.
    * 
@@ -402,6 +734,31 @@ void onRadioreceived( MicroBitEvent e);
    */
   void onPinEvent(MicroBitEvent evt);
 
+  /**
+   * @brief Send events in the ring until empty and wait for the next ones.
+   *
+   */
+  void startEventSending();
+
+  /**
+   * @brief Send events in the ring until it is empty.
+   *
+   */
+  void sendEvents();
+
+  /**
+   * @brief Wake the fiber sending events periodically while polled work remains.
+   *
+   */
+  void startEventTicking();
+
+  /**
+   * @brief Return the count of events dropped because a ring was full.
+   *
+   * @return uint32_t count of dropped events since boot
+   */
+  uint32_t getEventsDropped();
+
   /**
    * @brief Display friendly name of the micro:bit.
    * 
@@ -414,6 +771,34 @@ void onRadioreceived( MicroBitEvent e);
    */
   void displayVersion();
 
+  /**
+   * @brief Restore the compass calibration from the storage.
+   *
+   * @return true the calibration was restored
+   * @return false no calibration was stored
+   */
+  bool restoreCompassCalibration();
+
+  /**
+   * @brief Calibrate the compass and store the calibration.
+   *
+   */
+  void calibrateCompass();
+
+  /**
+   * @brief Store whether the radio is enabled at start.
+   *
+   * @param onStart true to enable the radio at start
+   */
+  void setRadioOnStart(bool onStart);
+
+  /**
+   * @brief Whether the radio is enabled at start by the stored setting.
+   *
+   * @return true the radio-on-start setting is stored
+   */
+  bool isRadioOnStart();
+
 private:
   /**
    * @brief Listen pin events on the pin.
@@ -422,8 +807,9 @@ private:
    * 
    * @param pinIndex index in edge pins
    * @param eventType type of events
+   * @param gateTime gate time of counting mode [ms]
    */
-  void listenPinEventOn(int pinIndex, int eventType);
+  void listenPinEventOn(int pinIndex, int eventType, uint16_t gateTime = MBIT_MORE_PIN_COUNTER_GATE_TIME);
 
   /**
    * @brief Set pull-mode.
@@ -441,6 +827,37 @@ private:
    */
   void setDigitalValue(int pinIndex, int value);
 
+  /**
+   * @brief Stop reporting the pin as an input because it is going to be an output.
+   * 
+   * @param pinIndex index in edge pins
+   */
+  void releasePinInput(int pinIndex);
+
+  /**
+   * @brief Set the values on the pins in the mask as digital output at once.
+   *
+   * @param mask bits of pin indexes to set
+   * @param values bits of digital values
+   */
+  void setDigitalValues(uint32_t mask, uint32_t values);
+
+  /**
+   * @brief Read the values on the pins in the mask as digital input at once.
+   * Digital outputs are read from OUT register without changing them.
+   *
+   * @param mask bits of pin indexes to read, and the pins read at return
+   * @return uint32_t bits of digital values
+   */
+  uint32_t getDigitalValues(uint32_t &mask);
+
+  /**
+   * @brief Send digital values of the pins in the mask to the host.
+   *
+   * @param mask bits of pin indexes to read
+   */
+  void sendDigitalValues(uint32_t mask);
+
   /**
    * @brief Set the value on the pin as analog output (PWM).
    * 
@@ -473,6 +890,346 @@ private:
    */
   void onGestureChanged(MicroBitEvent evt);
 
+  /**
+   * @brief Ring of events from listeners to the fiber sending them.
+   */
+  MbitMoreEventRecord eventRing[MBIT_MORE_EVENT_RING_SIZE];
+
+  /**
+   * @brief Count of events put in the ring which is written only by the listeners.
+   */
+  volatile uint32_t eventRingHead = 0;
+
+  /**
+   * @brief Count of events taken from the ring which is written only by the fiber.
+   */
+  volatile uint32_t eventRingTail = 0;
+
+  /**
+   * @brief Count of events dropped because the ring was full.
+   */
+  volatile uint32_t eventsDropped = 0;
+
+  /**
+   * @brief Whether the fiber sending events is waiting for the wake event.
+   */
+  volatile bool eventSendingWaiting = false;
+
+  /**
+   * @brief Whether the fiber waking the sender periodically is running.
+   */
+  bool eventTicking = false;
+
+  /**
+   * @brief Steps of the output sequence in order of the offset.
+   */
+  MbitMoreSequenceStep sequenceSteps[MBIT_MORE_SEQUENCE_SIZE];
+
+  /**
+   * @brief Number of steps in the output sequence.
+   */
+  volatile size_t sequenceLength = 0;
+
+  /**
+   * @brief Number of loops to play the sequence, 0 is endless.
+   */
+  uint8_t sequenceLoops = 1;
+
+  /**
+   * @brief Period of a loop [us], 0 is the offset of the last step.
+   */
+  uint32_t sequencePeriod = 0;
+
+  /**
+   * @brief Whether the sequence is playing or not.
+   */
+  volatile bool sequencePlaying = false;
+
+  /**
+   * @brief Whether the sequence should be played from the first step or not.
+   */
+  volatile bool sequenceRestart = false;
+
+  /**
+   * @brief Whether the fiber to play the sequence is running or not.
+   */
+  bool sequenceFiberRunning = false;
+
+  /**
+   * @brief Whether the fiber playing the sequence is waiting for the wake event or not.
+   */
+  volatile bool sequenceWaiting = false;
+
+#if !MICROBIT_CODAL
+  /**
+   * @brief Timer to wake the fiber playing the sequence just before a step.
+   */
+  Timeout sequenceTimeout;
+#endif // !MICROBIT_CODAL
+
+  /**
+   * @brief Process a command about the output sequence.
+   *
+   * @param data command
+   * @param length length of the command
+   */
+  void onSequenceCommand(uint8_t *data, size_t length);
+
+  /**
+   * @brief Whether the steps in SEQUENCE_ADD can be appended to the sequence.
+   *
+   * @param data command
+   * @param length length of the command
+   * @return true the steps are in order
+   * @return false a step is out of order or overlaps another step
+   */
+  bool isSequenceInOrder(uint8_t *data, size_t length);
+
+  /**
+   * @brief Wait until the time of a step.
+   *
+   * @param target time of the step [us]
+   * @return true the time has come
+   * @return false the sequence was stopped or restarted while waiting
+   */
+  bool waitSequenceUntil(uint32_t target);
+
+  /**
+   * @brief Run the action of the step.
+   *
+   * @param step step to run
+   */
+  void runSequenceStep(MbitMoreSequenceStep *step);
+
+  /**
+   * @brief Event-action rules.
+   */
+  MbitMoreRule rules[MBIT_MORE_RULE_SLOTS];
+
+  /**
+   * @brief Time when thresholds of rules were checked last [ms].
+   */
+  uint32_t ruleThresholdsCheckedAt = 0;
+
+  /**
+   * @brief Set an event-action rule.
+   *
+   * @param data command
+   * @param length length of the command
+   */
+  void setRule(uint8_t *data, size_t length);
+
+  /**
+   * @brief Run actions of the rules which are triggered by the event.
+   *
+   * @param trigger MbitMoreRuleTrigger of the event
+   * @param source pin index or MbitMoreEventMaskSource of the event
+   * @param evt event which triggers
+   */
+  void triggerRules(int trigger, int source, MicroBitEvent &evt);
+
+  /**
+   * @brief Run actions of the rules whose analog value crossed the threshold.
+   *
+   */
+  void checkRuleThresholds();
+
+  /**
+   * @brief Send to the host that the rule was disabled.
+   *
+   * @param index index of the rule
+   * @param trigger MbitMoreRuleTrigger which the rule had
+   * @param source pin index of the trigger
+   */
+  void sendRuleDisabled(int index, int trigger, int source);
+
+  /**
+   * @brief Run the action of the rule.
+   *
+   * @param rule rule to run
+   */
+  void runRuleAction(MbitMoreRule *rule);
+
+  /**
+   * @brief Write the level on the pin with the GPIO register if it is a digital output.
+   *
+   * @param pinIndex index in edge pins
+   * @param value digital value [0 | 1]
+   * @return true the level was written
+   * @return false the pin is not a digital output
+   */
+  bool writeDigitalOutput(int pinIndex, int value);
+
+  /**
+   * @brief Masks of events to send for each MbitMoreEventMaskSource.
+   * Bit n is set to send the event whose value is n.
+   */
+  uint16_t eventMasks[MBIT_MORE_EVENT_MASK_SOURCES];
+
+  /**
+   * @brief Whether the event should be sent or not.
+   *
+   * @param source MbitMoreEventMaskSource of the event
+   * @param value event ID
+   * @return true the event is wanted by the host
+   * @return false the event is masked
+   */
+  bool isEventWanted(int source, int value);
+
+  /**
+   * @brief Keep the state bitmap with a button event.
+   *
+   * @param evt event which has button states
+   */
+  void updateButtonLevel(MicroBitEvent &evt);
+
+  /**
+   * @brief Keep the state bitmap with a pin event.
+   *
+   * @param evt event of the pin
+   */
+  void updatePinLevel(MicroBitEvent &evt);
+
+  /**
+   * @brief Put an event into the ring to be sent by the fiber.
+   *
+   * @param kind kind of the event
+   * @param evt event to send
+   */
+  void enqueueEvent(MbitMoreEventKind kind, MicroBitEvent &evt);
+
+  /**
+   * @brief Wake the fiber sending events if it is waiting.
+   * This may be called in an interrupt.
+   */
+  void wakeEventSending();
+
+  /**
+   * @brief Start the fiber waking the sender periodically if it is not running.
+   */
+  void requestEventTicking();
+
+  /**
+   * @brief Whether pin counters or threshold rules need polling.
+   *
+   * @return true polling is needed
+   */
+  bool hasPolledWork();
+
+  /**
+   * @brief Read the event at the tail of the ring without releasing it.
+   *
+   * @param evt event to be read
+   * @return MbitMoreEventKind kind of the event
+   */
+  MbitMoreEventKind peekEvent(MicroBitEvent &evt);
+
+  /**
+   * @brief Send pin events in a row at the tail of the ring in a batch.
+   *
+   */
+  void sendPinEvents();
+
+  /**
+   * @brief Send button and gesture events in a row at the tail of the ring in a batch.
+   *
+   */
+  void sendActionEvents();
+
+  /**
+   * @brief Put a button or gesture event in a batch of ACTION_EVENTS.
+   *
+   * @param data buffer to put the event
+   * @param kind EVENT_BUTTON or EVENT_GESTURE
+   * @param evt event to put
+   * @return size_t length of the event in the batch
+   */
+  size_t putActionEvent(uint8_t *data, MbitMoreEventKind kind, MicroBitEvent &evt);
+
+  /**
+   * @brief Send a pin event to the host.
+   *
+   * @param evt event of the pin
+   */
+  void sendPinEvent(MicroBitEvent evt);
+
+  /**
+   * @brief Send a button event to the host.
+   *
+   * @param evt event which has button states
+   */
+  void sendButtonEvent(MicroBitEvent evt);
+
+  /**
+   * @brief Send a gesture event to the host.
+   *
+   * @param evt event which has gesture states.
+   */
+  void sendGestureEvent(MicroBitEvent evt);
+
+  /**
+   * @brief Callback. Invoked when an edge of a pin in capture mode.
+   *
+   * @param evt event of the edge
+   */
+  void onPinEdgeCaptured(MicroBitEvent evt);
+
+  /**
+   * @brief Ring of edges from the listener to the fiber sending them.
+   */
+  MbitMoreEdgeRecord captureRing[MBIT_MORE_CAPTURE_RING_SIZE];
+
+  /**
+   * @brief Count of edges put in the ring which is written only by the listener.
+   */
+  volatile uint32_t captureRingHead = 0;
+
+  /**
+   * @brief Count of edges taken from the ring which is written only by the fiber.
+   */
+  volatile uint32_t captureRingTail = 0;
+
+  /**
+   * @brief Send captured edges in batches until the ring is empty.
+   *
+   */
+  void sendCapturedEdges();
+
+  /**
+   * @brief Counters of pins in counting mode.
+   */
+  MbitMorePinCounter pinCounters[MBIT_MORE_PIN_COUNTER_SLOTS];
+
+  /**
+   * @brief Start counting edges on the pin.
+   *
+   * @param pinIndex index in edge pins
+   * @param gateTime gate time [ms]
+   * @return true counting was started
+   * @return false no slot was available
+   */
+  bool startPinCounter(int pinIndex, uint16_t gateTime);
+
+  /**
+   * @brief Stop counting edges on the pin.
+   *
+   * @param pinIndex index in edge pins
+   */
+  void stopPinCounter(int pinIndex);
+
+  /**
+   * @brief Callback. Invoked when an edge of a pin in counting mode.
+   *
+   * @param evt event of the edge
+   */
+  void onPinEdgeCounted(MicroBitEvent evt);
+
+  /**
+   * @brief Send results of pin counters whose gate time has passed.
+   *
+   */
+  void sendPinCounts();
+
   /**
    * @brief Normalize angle when upside down.
    * 
@@ -1,57 +1,1460 @@
 #include "pxt.h"
 
 #include "MbitMoreRadio.h"
+#include "MbitMoreRadioPacket.h"
 
+#include "nrf.h"
 
+static MbitMoreRadio *radio; // Hold it as a static pointer to be called by create_fiber().
+
+/**
+ * @brief Start a process to retransmit reliable frames.
+ * 
+ */
+void startMbitMoreRadioRetransmitting() {
+  radio->startRetransmitting();
+}
+
+/**
+ * @brief Start a process to relay frames.
+ * 
+ */
+void startMbitMoreRadioRelaying() {
+  radio->startRelaying();
+}
+
+/**
+ * @brief Start a process to send the rest of fragments of messages.
+ * 
+ */
+void startMbitMoreRadioFragmenting() {
+  radio->startFragmenting();
+}
+
+/**
+ * @brief Start a process to broadcast telemetry.
+ * 
+ */
+void startMbitMoreRadioTelemetry() {
+  radio->startTelemetry();
+}
+
+/**
+ * @brief Start a process to send time beacons.
+ * 
+ */
+void startMbitMoreRadioBeacon() {
+  radio->startBeacon();
+}
+
+/**
+ * @brief Start a process to adapt transmit power.
+ * 
+ */
+void startMbitMoreRadioAdaptivePower() {
+  radio->startAdaptivePower();
+}
+
+/**
+ * @brief Start a process of duty-cycled listening.
+ * 
+ */
+void startMbitMoreRadioDutyCycle() {
+  radio->startDutyCycle();
+}
+
+/**
+ * @brief Transmit power [dBm] of each power level.
+ */
+static const int8_t radioPowerDbm[MBIT_MORE_RADIO_POWER_LEVELS] = {-30, -20, -16, -12, -8, -4, 0, 4};
 
 MbitMoreRadio::MbitMoreRadio(MbitMoreDevice &_mbitMore) : mbitMore(_mbitMore) {
-   
+  radio = this;
+  uBit.radio.enable();
 
-uBit.radio.enable();
+  Radiosetgroup(0);
+  Radiosetsignalpower(7);
+}
+
+void MbitMoreRadio::Radiosetsignalpower(int signalpower) {
+  if (signalpower < 0 || signalpower >= MBIT_MORE_RADIO_POWER_LEVELS)
+    return;
+  signalPower = signalpower;
+  uBit.radio.setTransmitPower(signalpower);
+}
 
- Radiosetgroup(0);
- Radiosetsignalpower(7);
+void MbitMoreRadio::Radiosetgroup(int group) {
+  radioGroup = group;
+  uBit.radio.setGroup(group);
+}
 
+/**
+ * @brief Set the frequency band.
+ *
+ * @param band frequency band in the range 0 - 83 (2400 + band [MHz])
+ */
+void MbitMoreRadio::setFrequencyBand(int band) {
+  frequencyBand = band;
+  if (radioSleeping)
+    return; // It will be set when the radio wakes up.
+  uBit.radio.setFrequencyBand(band);
+}
+
+/**
+ * @brief Set the data rate on the air.
+ * All micro:bits in the group must use the same data rate.
+ *
+ * @param rate data rate to set
+ */
+void MbitMoreRadio::setDataRate(MbitMoreRadioDataRate rate) {
+  dataRate = rate;
+  applyDataRate();
+}
 
+/**
+ * @brief Set the data rate to the radio peripheral which was enabled.
+ * The runtime has no API for the data rate and enable() resets it to 1 Mbps.
+ */
+void MbitMoreRadio::applyDataRate() {
+  if (radioSleeping)
+    return; // It will be set when the radio wakes up.
+  uint32_t mode = (dataRate == MbitMoreRadioDataRate::RADIO_2MBPS) ? RADIO_MODE_MODE_Nrf_2Mbit : RADIO_MODE_MODE_Nrf_1Mbit;
+  if (NRF_RADIO->MODE == mode)
+    return;
+  // Restart receiving in the same way as setFrequencyBand() to take effect.
+  NRF_RADIO->EVENTS_DISABLED = 0;
+  NRF_RADIO->TASKS_DISABLE = 1;
+  while (NRF_RADIO->EVENTS_DISABLED == 0)
+    ;
+  NRF_RADIO->MODE = mode;
+  NRF_RADIO->EVENTS_READY = 0;
+  NRF_RADIO->TASKS_RXEN = 1;
+  while (NRF_RADIO->EVENTS_READY == 0)
+    ;
+  NRF_RADIO->EVENTS_END = 0;
+  NRF_RADIO->TASKS_START = 1;
+}
 
+/**
+ * @brief Return RSSI of the last received packet.
+ *
+ * @return int RSSI [dBm]
+ */
+int MbitMoreRadio::lastPacketSignal() {
+  return lastSignal;
 }
 
-void MbitMoreRadio::Radiosetsignalpower(int signalpower){
+/**
+ * @brief Take a cleared packet buffer from the pool.
+ * The buffer stays valid until the pool wraps around.
+ *
+ * @return uint8_t* buffer of RADIOSENDPACKETSIZE bytes
+ */
+uint8_t *MbitMoreRadio::allocPacket() {
+  uint8_t *packet = packetPool[packetPoolNext];
+  packetPoolNext = (packetPoolNext + 1) % MBIT_MORE_RADIO_PACKET_POOL_SIZE;
+  memset(packet, 0, RADIOSENDPACKETSIZE);
+  return packet;
+}
 
- uBit.radio.setTransmitPower(signalpower);
+/**
+ * @brief Send the packet without copying it into a heap buffer.
+ *
+ * @param buf packet to send
+ * @param len length of the packet
+ */
+void MbitMoreRadio::sendrawpacket(uint8_t buf[], int len) {
+  // Wake up the sleeping radio only while sending.
+  setRadioSleeping(false);
+  // send(uint8_t *, int) copies into the frame buffer of the radio directly,
+  // while a PacketBuffer would allocate its own copy on the heap.
+  uBit.radio.datagram.send(buf, len);
+  updateRadioSleeping();
+}
 
+/**
+ * @brief Receive a datagram into a buffer of the pool.
+ * [0..31] is the radio packet and [32..35] is the RSSI as int32_t big-endian.
+ *
+ * @param length length of the received datagram
+ * @return uint8_t* received packet or NULL when no datagram is waiting
+ */
+uint8_t *MbitMoreRadio::receivePacket(size_t *length) {
+  // PacketBuffer keeps RSSI of its own datagram, while getRSSI() of the radio
+  // is of the last frame received which may be newer than the queued one.
+  // The runtime allocates the PacketBuffer and it is released at the return,
+  // then this path keeps no heap memory.
+  PacketBuffer received = uBit.radio.datagram.recv();
+  int receivedLength = received.length();
+  if (receivedLength <= 0) {
+    return NULL;
+  }
+  *length = (receivedLength < RADIOPACKETSIZE) ? receivedLength : RADIOPACKETSIZE;
+  uint8_t *packet = allocPacket();
+  memcpy(packet, received.getBytes(), *length);
+  int signal = received.getRSSI();
+  lastSignal = signal;
+  packet[RADIOPACKETSIZE] = (signal >> 24) & 0xFF;
+  packet[RADIOPACKETSIZE + 1] = (signal >> 16) & 0xFF;
+  packet[RADIOPACKETSIZE + 2] = (signal >> 8) & 0xFF;
+  packet[RADIOPACKETSIZE + 3] = signal & 0xFF;
+  updateNode(packet, signal);
+  return packet;
+}
 
- 
+/**
+ * @brief Find the entry of the sender in the node table.
+ * This does not change the table to be used on send paths.
+ *
+ * @param serial serial number of the sender
+ * @return MbitMoreRadioNode* entry of the sender or NULL when not in the table
+ */
+MbitMoreRadioNode *MbitMoreRadio::lookupNode(uint32_t serial) {
+  if (serial == 0)
+    return NULL;
+  size_t start = (serial * 2654435761u) >> 24;
+  for (size_t i = 0; i < MBIT_MORE_RADIO_NODE_TABLE_SIZE; i++) {
+    MbitMoreRadioNode *slot = &nodeTable[(start + i) & (MBIT_MORE_RADIO_NODE_TABLE_SIZE - 1)];
+    if (slot->serial == serial)
+      return slot;
+    if (slot->serial == 0)
+      return NULL;
+  }
+  return NULL;
+}
 
+/**
+ * @brief Find or add the entry of the sender in the node table.
+ * A cleared entry is assigned when the sender is not in the table.
+ *
+ * @param serial serial number of the sender
+ * @return MbitMoreRadioNode* entry of the sender
+ */
+MbitMoreRadioNode *MbitMoreRadio::addNode(uint32_t serial) {
+  // Fibonacci hashing to spread serial numbers, then linear probing.
+  size_t start = (serial * 2654435761u) >> 24;
+  MbitMoreRadioNode *oldest = NULL;
+  for (size_t i = 0; i < MBIT_MORE_RADIO_NODE_TABLE_SIZE; i++) {
+    MbitMoreRadioNode *slot = &nodeTable[(start + i) & (MBIT_MORE_RADIO_NODE_TABLE_SIZE - 1)];
+    if (slot->serial == serial) {
+      return slot;
+    }
+    if (slot->serial == 0) {
+      oldest = slot;
+      break;
+    }
+    if (oldest == NULL || (int32_t)(slot->lastSeen - oldest->lastSeen) < 0) {
+      oldest = slot;
+    }
+  }
+  // Overwriting the oldest when the table is full keeps probe chains intact
+  // as no slot becomes empty.
+  memset(oldest, 0, sizeof(MbitMoreRadioNode));
+  oldest->serial = serial;
+  oldest->lastSeen = (uint32_t)system_timer_current_time();
+  // Counting from a random number keeps a new entry out of the window which
+  // the node may still have for this micro:bit.
+  oldest->reliableSequence = (uint16_t)microbit_random(0x10000);
+  return oldest;
+}
 
+/**
+ * @brief Update the node table with a received packet.
+ *
+ * @param packet received packet
+ * @param signal RSSI of the packet [dBm]
+ */
+void MbitMoreRadio::updateNode(const uint8_t *packet, int signal) {
+  uint32_t serial = mbitMoreRadioPacketSerial(packet);
+  if (serial == 0)
+    return;
+  if (packet[0] == MbitMoreRadioPacketState::FRAME &&
+      (packet[MBIT_MORE_RADIO_FRAME_FLAGS_INDEX] & MBIT_MORE_RADIO_FRAME_RELAYED))
+    return; // RSSI and sequence of a relayed frame are not of the sender.
+  MbitMoreRadioNode *node = addNode(serial);
+  int8_t rssi = (int8_t)signal;
+  if (node->packets == 0) {
+    node->rssiAverage = rssi * 16;
+    node->rssiMin = rssi;
+    node->rssiMax = rssi;
+  }
+  node->lastSeen = (uint32_t)system_timer_current_time();
+  if (node->packets < 0xFFFF)
+    node->packets++;
+  // EWMA with alpha = 1/8 in fixed-point of 1/16 dBm.
+  node->rssiAverage += (rssi * 16 - node->rssiAverage) / 8;
+  if (rssi < node->rssiMin)
+    node->rssiMin = rssi;
+  if (rssi > node->rssiMax)
+    node->rssiMax = rssi;
+  if (packet[0] == MbitMoreRadioPacketState::FRAME) {
+    node->sleepy = (packet[MBIT_MORE_RADIO_FRAME_FLAGS_INDEX] & MBIT_MORE_RADIO_FRAME_SLEEPY) != 0;
+    uint16_t sequence;
+    memcpy(&sequence, &packet[MBIT_MORE_RADIO_FRAME_SEQUENCE_INDEX], 2);
+    if (node->hasSequence) {
+      uint16_t gap = sequence - node->sequence;
+      // Gaps over the half of the range are reordered or repeated frames.
+      if (gap > 1 && gap < 0x8000) {
+        uint32_t lost = node->lost + gap - 1;
+        node->lost = (lost < 0xFFFF) ? lost : 0xFFFF;
+      }
+      if (gap == 0 || gap >= 0x8000)
+        return;
+    }
+    node->sequence = sequence;
+    node->hasSequence = true;
+  }
+}
 
+/**
+ * @brief Write the header of a Microbit More frame with the next sequence number.
+ * TTL of this micro:bit is set in the low nibble of the flags
+ * and SLEEPY is set while duty-cycled listening.
+ *
+ * @param packet buffer to write
+ * @param kind kind of the frame
+ * @param flags flags of the frame
+ */
+void MbitMoreRadio::encodeFrameHeader(uint8_t *packet, uint8_t kind, uint8_t flags) {
+  packet[0] = MbitMoreRadioPacketState::FRAME;
+  packet[MBIT_MORE_RADIO_FRAME_KIND_INDEX] = kind;
+  packet[MBIT_MORE_RADIO_FRAME_FLAGS_INDEX] = (flags & ~MBIT_MORE_RADIO_FRAME_TTL_MASK) | frameTTL |
+                                             (dutyCycling ? MBIT_MORE_RADIO_FRAME_SLEEPY : 0);
+  uint32_t serial = microbit_serial_number();
+  memcpy(&packet[MBIT_MORE_RADIO_FRAME_SERIAL_INDEX], &serial, 4);
+  memcpy(&packet[MBIT_MORE_RADIO_FRAME_SEQUENCE_INDEX], &frameSequence, 2);
+  frameSequence++;
 }
 
+/**
+ * @brief Process a received frame of Microbit More protocol.
+ * Duplicates which came through relays and frames of this micro:bit are ignored.
+ * Frames to this micro:bit are not relayed because they reached the destination.
+ *
+ * @param packet received frame
+ * @param length length of the frame
+ * @param receivedAt local clock when the frame was received
+ */
+void MbitMoreRadio::receiveFrame(const uint8_t *packet, size_t length, uint64_t receivedAt) {
+  if (length < MBIT_MORE_RADIO_FRAME_HEADER_SIZE)
+    return;
+  if (mbitMoreRadioPacketSerial(packet) == microbit_serial_number())
+    return;
+  if (isSeenFrame(packet))
+    return;
+  if (relaying && frameDestination(packet) != microbit_serial_number())
+    relayFrame(packet, length);
+  switch (packet[MBIT_MORE_RADIO_FRAME_KIND_INDEX]) {
+  case MbitMoreRadioFrameKind::FRAGMENT:
+    receiveFragment(packet);
+    break;
 
-void MbitMoreRadio::Radiosetgroup(int group){
+  case MbitMoreRadioFrameKind::RELIABLE:
+    receiveReliable(packet);
+    break;
 
-    uBit.radio.setGroup(group);
-    
+  case MbitMoreRadioFrameKind::ACK:
+    receiveAck(packet);
+    break;
 
+  case MbitMoreRadioFrameKind::COMMAND:
+    receiveCommand(packet);
+    break;
 
+  case MbitMoreRadioFrameKind::RESULT:
+    receiveResult(packet);
+    break;
+
+  case MbitMoreRadioFrameKind::TELEMETRY_STATE:
+    receiveTelemetry(packet, MM_CH_BUFFER_SIZE_STATE);
+    break;
+
+  case MbitMoreRadioFrameKind::TELEMETRY_MOTION:
+    receiveTelemetry(packet, MM_CH_BUFFER_SIZE_MOTION);
+    break;
+
+  case MbitMoreRadioFrameKind::BEACON:
+    if (!(packet[MBIT_MORE_RADIO_FRAME_FLAGS_INDEX] & MBIT_MORE_RADIO_FRAME_RELAYED)) {
+      // The link is assumed to be symmetric.
+      feedbackSignal((int8_t)packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 8], lastSignal);
+      // Listen windows are aligned to this beacon.
+      memcpy(&beaconPeriod, &packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 9], 2);
+      beaconReceivedAt = (uint32_t)system_timer_current_time();
+      if (beaconReceivedAt == 0)
+        beaconReceivedAt = 1;
+      missedBeacons = 0;
+    }
+    receiveBeacon(packet, receivedAt);
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief Send a message in fragments.
+ * Fragment has [0] message ID, [1] index, [2] count and [3] length of the data in the payload.
+ * The first fragment is sent at once and the rest are paced by another fiber
+ * because the RX queue of the runtime holds only a few datagrams.
+ * Messages over a fragment come only from the serial fiber (BLE writes fit in a fragment),
+ * so that it can sleep while the outgoing ring is full.
+ *
+ * @param data content of the message
+ * @param length length of the message (MBIT_MORE_RADIO_MESSAGE_SIZE at most)
+ */
+void MbitMoreRadio::sendMessage(const uint8_t *data, size_t length) {
+  if (length > MBIT_MORE_RADIO_MESSAGE_SIZE)
+    length = MBIT_MORE_RADIO_MESSAGE_SIZE;
+  size_t count = (length + MBIT_MORE_RADIO_FRAGMENT_DATA_SIZE - 1) / MBIT_MORE_RADIO_FRAGMENT_DATA_SIZE;
+  if (count == 0)
+    count = 1;
+  if (count == 1) {
+    sendFragment(data, length, messageID++, 0, 1);
+    return;
+  }
+  while ((outgoingHead - outgoingTail) >= MBIT_MORE_RADIO_OUTGOING_SLOTS) {
+    fiber_sleep(MBIT_MORE_RADIO_FRAGMENT_INTERVAL);
+  }
+  MbitMoreRadioOutgoingMessage *message = &outgoing[outgoingHead % MBIT_MORE_RADIO_OUTGOING_SLOTS];
+  message->messageID = messageID++;
+  message->count = (uint8_t)count;
+  message->length = (uint8_t)length;
+  memcpy(message->data, data, length);
+  message->nextIndex = 0;
+  if (outgoingHead == outgoingTail) {
+    // Nothing is being paced, then the first fragment need not wait.
+    sendFragment(message->data, message->length, message->messageID, 0, message->count);
+    message->nextIndex = 1;
+  }
+  outgoingHead = outgoingHead + 1;
+  if (!fragmentingRunning) {
+    fragmentingRunning = true;
+    create_fiber(startMbitMoreRadioFragmenting);
+  }
+}
+
+/**
+ * @brief Send a fragment of a message.
+ *
+ * @param data content of the message
+ * @param length length of the message
+ * @param id ID of the message
+ * @param index index of the fragment
+ * @param count count of fragments
+ */
+void MbitMoreRadio::sendFragment(const uint8_t *data, size_t length, uint8_t id, uint8_t index, uint8_t count) {
+  size_t offset = index * MBIT_MORE_RADIO_FRAGMENT_DATA_SIZE;
+  size_t dataLength = length - offset;
+  if (dataLength > MBIT_MORE_RADIO_FRAGMENT_DATA_SIZE)
+    dataLength = MBIT_MORE_RADIO_FRAGMENT_DATA_SIZE;
+  uint8_t *packet = allocPacket();
+  encodeFrameHeader(packet, MbitMoreRadioFrameKind::FRAGMENT, 0);
+  uint8_t *payload = &packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE];
+  payload[0] = id;
+  payload[1] = index;
+  payload[2] = count;
+  payload[3] = (uint8_t)dataLength;
+  memcpy(&payload[4], &data[offset], dataLength);
+  sendrawpacket(packet, MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 4 + dataLength);
+}
+
+/**
+ * @brief Send the rest of fragments of outgoing messages until all of them were sent.
+ * A fragment is sent in each MBIT_MORE_RADIO_FRAGMENT_INTERVAL in order of the messages.
+ */
+void MbitMoreRadio::startFragmenting() {
+  while (outgoingTail != outgoingHead) {
+    fiber_sleep(MBIT_MORE_RADIO_FRAGMENT_INTERVAL);
+    MbitMoreRadioOutgoingMessage *message = &outgoing[outgoingTail % MBIT_MORE_RADIO_OUTGOING_SLOTS];
+    sendFragment(message->data, message->length, message->messageID, message->nextIndex, message->count);
+    message->nextIndex++;
+    if (message->nextIndex >= message->count) {
+      outgoingTail = outgoingTail + 1;
+    }
+  }
+  fragmentingRunning = false;
+}
+
+/**
+ * @brief Reassemble a message with a received fragment.
+ * The message is notified to the host when all fragments were received.
+ *
+ * @param packet received frame of FRAGMENT
+ */
+void MbitMoreRadio::receiveFragment(const uint8_t *packet) {
+  uint32_t serial = mbitMoreRadioPacketSerial(packet);
+  const uint8_t *payload = &packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE];
+  uint8_t id = payload[0];
+  uint8_t index = payload[1];
+  uint8_t count = payload[2];
+  uint8_t dataLength = payload[3];
+  if (count == 0 || count > 8 || index >= count ||
+      dataLength > MBIT_MORE_RADIO_FRAGMENT_DATA_SIZE ||
+      (index * MBIT_MORE_RADIO_FRAGMENT_DATA_SIZE + dataLength) > MBIT_MORE_RADIO_MESSAGE_SIZE)
+    return;
+
+  // Evict incomplete messages which timed out and find the slot for this message.
+  uint32_t now = (uint32_t)system_timer_current_time();
+  MbitMoreRadioReassembly *slot = NULL;
+  MbitMoreRadioReassembly *oldest = NULL;
+  for (size_t i = 0; i < MBIT_MORE_RADIO_REASSEMBLY_SLOTS; i++) {
+    MbitMoreRadioReassembly *r = &reassembly[i];
+    if (r->serial != 0 && (now - r->startedAt) > MBIT_MORE_RADIO_REASSEMBLY_TIMEOUT) {
+      r->serial = 0;
+    }
+    if (r->serial == serial && r->messageID == id && r->count == count) {
+      slot = r;
+    }
+    if (oldest == NULL || r->serial == 0 ||
+        (oldest->serial != 0 && (int32_t)(r->startedAt - oldest->startedAt) < 0)) {
+      oldest = r;
+    }
+  }
+  if (slot == NULL) {
+    slot = oldest;
+    slot->serial = serial;
+    slot->messageID = id;
+    slot->count = count;
+    slot->receivedMask = 0;
+    slot->length = 0;
+    slot->startedAt = now;
+  }
+  memcpy(&slot->data[index * MBIT_MORE_RADIO_FRAGMENT_DATA_SIZE], &payload[4], dataLength);
+  slot->receivedMask |= (1 << index);
+  if (index == count - 1) {
+    slot->length = index * MBIT_MORE_RADIO_FRAGMENT_DATA_SIZE + dataLength;
+  }
+  if (slot->receivedMask != (uint8_t)((1 << count) - 1))
+    return;
+
+  // Message is sent as [0..3] serial number of the sender, [4] message ID, [5] length and the content.
+  uint8_t message[6 + MBIT_MORE_RADIO_MESSAGE_SIZE];
+  memcpy(&message[0], &slot->serial, 4);
+  message[4] = slot->messageID;
+  message[5] = slot->length;
+  memcpy(&message[6], slot->data, slot->length);
+  slot->serial = 0;
+  notifyHost(0x0143, message, 6 + message[5]);
 }
 
-void MbitMoreRadio::sendrawpacket( uint8_t buf[],int len){
-PacketBuffer b(buf,len);
+/**
+ * @brief Send data to a micro:bit and retransmit it until ack is received.
+ * Reliable frame has [0..3] serial number of the destination, [4..5] sequence number
+ * and [6] length of the data in the payload.
+ * Sequence numbers are counted for each destination in the node table, so that
+ * the destination can find retransmits in a window of the latest numbers.
+ *
+ * Destination 0 is reported as DELIVERY_FAILED at once.
+ *
+ * @param destination serial number of the destination
+ * @param data content to send
+ * @param length length of the content (MBIT_MORE_RADIO_RELIABLE_DATA_SIZE at most)
+ */
+void MbitMoreRadio::sendReliable(uint32_t destination, const uint8_t *data, size_t length) {
+  if (length > MBIT_MORE_RADIO_RELIABLE_DATA_SIZE)
+    length = MBIT_MORE_RADIO_RELIABLE_DATA_SIZE;
+  if (destination == 0) {
+    // 0 is a free slot and broadcast, which has no one to acknowledge.
+    MbitMoreRadioPendingFrame rejected = {0};
+    reportDelivery(&rejected, MbitMoreRadioDeliveryStatus::DELIVERY_FAILED);
+    return;
+  }
+  MbitMoreRadioNode *node = addNode(destination);
+  MbitMoreRadioPendingFrame *pending = NULL;
+  for (size_t i = 0; i < MBIT_MORE_RADIO_RELIABLE_SLOTS; i++) {
+    if (pendingFrames[i].destination == 0) {
+      pending = &pendingFrames[i];
+      break;
+    }
+  }
+  if (pending == NULL) {
+    // All slots are waiting for ack.
+    MbitMoreRadioPendingFrame rejected = {0};
+    rejected.destination = destination;
+    rejected.sequence = node->reliableSequence;
+    reportDelivery(&rejected, MbitMoreRadioDeliveryStatus::DELIVERY_FAILED);
+    return;
+  }
+  pending->destination = destination;
+  pending->sequence = node->reliableSequence++;
+  pending->retries = 0;
+  pending->timeout = MBIT_MORE_RADIO_RELIABLE_TIMEOUT;
+  pending->retransmitAt = (uint32_t)system_timer_current_time() + pending->timeout + microbit_random(pending->timeout);
+  encodeFrameHeader(pending->frame, MbitMoreRadioFrameKind::RELIABLE, 0);
+  uint8_t *payload = &pending->frame[MBIT_MORE_RADIO_FRAME_HEADER_SIZE];
+  memcpy(&payload[0], &destination, 4);
+  memcpy(&payload[4], &pending->sequence, 2);
+  payload[6] = (uint8_t)length;
+  memcpy(&payload[7], data, length);
+  pending->length = MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 7 + length;
+  // Listen for the ack even while duty-cycled listening.
+  keepRadioAwake(pending->retransmitAt);
+  if (sendFrameTo(destination, pending->frame, pending->length)) {
+    // Wait for ack after the listen window of the destination.
+    pending->retransmitAt += beaconInterval;
+    keepRadioAwake(pending->retransmitAt);
+  }
+  if (!retransmitting) {
+    retransmitting = true;
+    create_fiber(startMbitMoreRadioRetransmitting);
+  }
+}
+
+/**
+ * @brief Retransmit frames which were not acknowledged until all of them finish.
+ * Interval is doubled for each retransmit with random jitter to avoid collisions.
+ */
+void MbitMoreRadio::startRetransmitting() {
+  bool waiting = true;
+  while (waiting) {
+    fiber_sleep(5);
+    waiting = false;
+    uint32_t now = (uint32_t)system_timer_current_time();
+    for (size_t i = 0; i < MBIT_MORE_RADIO_RELIABLE_SLOTS; i++) {
+      MbitMoreRadioPendingFrame *pending = &pendingFrames[i];
+      if (pending->destination == 0)
+        continue;
+      waiting = true;
+      if ((int32_t)(now - pending->retransmitAt) < 0)
+        continue;
+      if (pending->retries >= MBIT_MORE_RADIO_RELIABLE_RETRIES) {
+        reportDelivery(pending, MbitMoreRadioDeliveryStatus::DELIVERY_FAILED);
+        pending->destination = 0;
+        continue;
+      }
+      pending->retries++;
+      pending->timeout *= 2;
+      // New sequence number not to be dropped as a duplicate by relays.
+      encodeFrameHeader(pending->frame, MbitMoreRadioFrameKind::RELIABLE, 0);
+      pending->retransmitAt = now + pending->timeout + microbit_random(pending->timeout);
+      keepRadioAwake(pending->retransmitAt);
+      if (sendFrameTo(pending->destination, pending->frame, pending->length)) {
+        pending->retransmitAt += beaconInterval;
+        keepRadioAwake(pending->retransmitAt);
+      }
+    }
+  }
+  // No more ack to wait for.
+  keepAwakeUntil = (uint32_t)system_timer_current_time();
+  updateRadioSleeping();
+  retransmitting = false;
+}
+
+/**
+ * @brief Receive a reliable frame, send ack and pass it to the host.
+ * Ack has [0..3] serial number of the sender of the reliable frame,
+ * [4..5] sequence number and [6] RSSI of the reliable frame.
+ * Duplicated frames are acknowledged again but not passed to the host.
+ *
+ * @param packet received frame of RELIABLE
+ */
+void MbitMoreRadio::receiveReliable(const uint8_t *packet) {
+  const uint8_t *payload = &packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE];
+  uint32_t destination;
+  memcpy(&destination, &payload[0], 4);
+  if (destination != microbit_serial_number())
+    return;
+  uint16_t sequence;
+  memcpy(&sequence, &payload[4], 2);
+  uint8_t length = payload[6];
+  if (length > MBIT_MORE_RADIO_RELIABLE_DATA_SIZE)
+    return;
+  uint32_t sender = mbitMoreRadioPacketSerial(packet);
+  if (sender == 0)
+    return;
 
+  uint8_t *ack = allocPacket();
+  encodeFrameHeader(ack, MbitMoreRadioFrameKind::ACK, 0);
+  memcpy(&ack[MBIT_MORE_RADIO_FRAME_HEADER_SIZE], &sender, 4);
+  memcpy(&ack[MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 4], &sequence, 2);
+  ack[MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 6] = (uint8_t)(int8_t)lastSignal;
+  sendrawpacket(ack, MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 7);
 
-uBit.radio.datagram.send(b);
+  // Relayed senders are added to the table to keep their window.
+  if (isSeenReliable(addNode(sender), sequence))
+    return;
 
+  // Data is sent as same as a message [0..3] sender, [4] lower byte of the sequence number,
+  // [5] length and the content.
+  uint8_t message[6 + MBIT_MORE_RADIO_RELIABLE_DATA_SIZE];
+  memcpy(&message[0], &sender, 4);
+  message[4] = (uint8_t)sequence;
+  message[5] = length;
+  memcpy(&message[6], &payload[7], length);
+  notifyHost(0x0143, message, 6 + length);
+}
+
+/**
+ * @brief Check the reliable frame was received from the node already and remember it.
+ * Numbers behind the window are taken as the sender restarted counting.
+ *
+ * @param node entry of the sender in the node table
+ * @param sequence reliable sequence number of the frame
+ * @return true the frame is a duplicate
+ * @return false the frame is new
+ */
+bool MbitMoreRadio::isSeenReliable(MbitMoreRadioNode *node, uint16_t sequence) {
+  int16_t ahead = (int16_t)(uint16_t)(sequence - node->reliableLast);
+  if (!node->hasReliable || ahead <= -MBIT_MORE_RADIO_RELIABLE_WINDOW) {
+    node->hasReliable = true;
+    node->reliableLast = sequence;
+    node->reliableWindow = 1;
+    return false;
+  }
+  if (ahead > 0) {
+    node->reliableWindow = (ahead < MBIT_MORE_RADIO_RELIABLE_WINDOW) ? (node->reliableWindow << ahead) : 0;
+    node->reliableWindow |= 1;
+    node->reliableLast = sequence;
+    return false;
+  }
+  uint32_t bit = (uint32_t)1 << -ahead;
+  if (node->reliableWindow & bit)
+    return true;
+  node->reliableWindow |= bit;
+  return false;
+}
 
+/**
+ * @brief Finish the pending frame which was acknowledged.
+ *
+ * @param packet received frame of ACK
+ */
+void MbitMoreRadio::receiveAck(const uint8_t *packet) {
+  const uint8_t *payload = &packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE];
+  uint32_t destination;
+  memcpy(&destination, &payload[0], 4);
+  if (destination != microbit_serial_number())
+    return;
+  uint32_t sender = mbitMoreRadioPacketSerial(packet);
+  for (size_t i = 0; i < MBIT_MORE_RADIO_RELIABLE_SLOTS; i++) {
+    MbitMoreRadioPendingFrame *pending = &pendingFrames[i];
+    if (pending->destination == sender && memcmp(&pending->sequence, &payload[4], 2) == 0) {
+      if (!(packet[MBIT_MORE_RADIO_FRAME_FLAGS_INDEX] & MBIT_MORE_RADIO_FRAME_RELAYED)) {
+        feedbackSignal(radioPowerDbm[signalPower], (int8_t)payload[6]);
+      }
+      reportDelivery(pending, MbitMoreRadioDeliveryStatus::DELIVERED);
+      pending->destination = 0;
+      return;
+    }
+  }
+}
 
+/**
+ * @brief Report the result of reliable delivery to the host.
+ * Result is sent as [0..3] destination, [4..5] sequence number, [6] status and [7] count of retransmits.
+ *
+ * @param pending frame which finished
+ * @param status result of the delivery
+ */
+void MbitMoreRadio::reportDelivery(MbitMoreRadioPendingFrame *pending, MbitMoreRadioDeliveryStatus status) {
+  uint8_t result[8];
+  memcpy(&result[0], &pending->destination, 4);
+  memcpy(&result[4], &pending->sequence, 2);
+  result[6] = status;
+  result[7] = pending->retries;
+  notifyHost(0x0144, result, 8);
 }
 
+/**
+ * @brief Set relay of frames from other micro:bits.
+ *
+ * @param on true to relay
+ * @param ttl max hops of frames which are sent from this micro:bit (15 at most)
+ */
+void MbitMoreRadio::setRelay(bool on, uint8_t ttl) {
+  relaying = on;
+  frameTTL = (ttl < MBIT_MORE_RADIO_FRAME_TTL_MASK) ? ttl : MBIT_MORE_RADIO_FRAME_TTL_MASK;
+}
 
+/**
+ * @brief Check the frame was received already and remember it.
+ *
+ * @param packet received frame
+ * @return true the frame is a duplicate
+ * @return false the frame is new
+ */
+bool MbitMoreRadio::isSeenFrame(const uint8_t *packet) {
+  uint16_t sequence;
+  memcpy(&sequence, &packet[MBIT_MORE_RADIO_FRAME_SEQUENCE_INDEX], 2);
+  uint32_t hash = (mbitMoreRadioPacketSerial(packet) * 2654435761u) ^ (sequence * 40503u);
+  if (hash == 0)
+    hash = 1; // 0 is an empty entry.
+  for (size_t i = 0; i < MBIT_MORE_RADIO_SEEN_CACHE_SIZE; i++) {
+    if (seenFrames[i] == hash)
+      return true;
+  }
+  seenFrames[seenFramesNext] = hash;
+  seenFramesNext = (seenFramesNext + 1) % MBIT_MORE_RADIO_SEEN_CACHE_SIZE;
+  return false;
+}
 
+/**
+ * @brief Return the destination of the frame.
+ * RELIABLE, ACK, COMMAND and RESULT have the destination at the head of the payload,
+ * and other kinds are to all micro:bits.
+ *
+ * @param packet received frame
+ * @return uint32_t serial number of the destination or MBIT_MORE_RADIO_COMMAND_BROADCAST
+ */
+uint32_t MbitMoreRadio::frameDestination(const uint8_t *packet) {
+  switch (packet[MBIT_MORE_RADIO_FRAME_KIND_INDEX]) {
+  case MbitMoreRadioFrameKind::RELIABLE:
+  case MbitMoreRadioFrameKind::ACK:
+  case MbitMoreRadioFrameKind::COMMAND:
+  case MbitMoreRadioFrameKind::RESULT: {
+    uint32_t destination;
+    memcpy(&destination, &packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE], 4);
+    return destination;
+  }
 
+  default:
+    return MBIT_MORE_RADIO_COMMAND_BROADCAST;
+  }
+}
 
-MbitMoreRadio::~MbitMoreRadio(){
+/**
+ * @brief Schedule to relay the frame after random jitter.
+ * The frame is dropped when TTL ran out or all slots are waiting.
+ * It is relayed in the length as received.
+ *
+ * @param packet received frame
+ * @param length length of the frame
+ */
+void MbitMoreRadio::relayFrame(const uint8_t *packet, size_t length) {
+  uint8_t flags = packet[MBIT_MORE_RADIO_FRAME_FLAGS_INDEX];
+  uint8_t ttl = flags & MBIT_MORE_RADIO_FRAME_TTL_MASK;
+  if (ttl == 0)
+    return;
+  for (size_t i = 0; i < MBIT_MORE_RADIO_RELAY_SLOTS; i++) {
+    MbitMoreRadioRelayFrame *relay = &relayFrames[i];
+    if (relay->waiting)
+      continue;
+    if (length > RADIOPACKETSIZE)
+      length = RADIOPACKETSIZE;
+    memcpy(relay->frame, packet, length);
+    relay->length = (uint8_t)length;
+    relay->frame[MBIT_MORE_RADIO_FRAME_FLAGS_INDEX] =
+        (flags & ~MBIT_MORE_RADIO_FRAME_TTL_MASK) | MBIT_MORE_RADIO_FRAME_RELAYED | (ttl - 1);
+    // Jitter avoids collisions with other relays which received the same frame.
+    relay->sendAt = (uint32_t)system_timer_current_time() + 1 + microbit_random(MBIT_MORE_RADIO_RELAY_JITTER);
+    relay->waiting = true;
+    if (!relayRunning) {
+      relayRunning = true;
+      create_fiber(startMbitMoreRadioRelaying);
+    }
+    return;
+  }
+}
 
+/**
+ * @brief Send frames waiting to be relayed until all of them were sent.
+ */
+void MbitMoreRadio::startRelaying() {
+  bool waiting = true;
+  while (waiting) {
+    fiber_sleep(1);
+    waiting = false;
+    uint32_t now = (uint32_t)system_timer_current_time();
+    for (size_t i = 0; i < MBIT_MORE_RADIO_RELAY_SLOTS; i++) {
+      MbitMoreRadioRelayFrame *relay = &relayFrames[i];
+      if (!relay->waiting)
+        continue;
+      if ((int32_t)(now - relay->sendAt) < 0) {
+        waiting = true;
+        continue;
+      }
+      sendrawpacket(relay->frame, relay->length);
+      relay->waiting = false;
+    }
+  }
+  relayRunning = false;
 }
 
+/**
+ * @brief Send a command to be run on other micro:bits.
+ * Command frame has [0..3] serial number of the destination, [4] options
+ * and [5] length of the command in the payload.
+ *
+ * @param destination serial number of the destination or MBIT_MORE_RADIO_COMMAND_BROADCAST
+ * @param options MBIT_MORE_RADIO_COMMAND_REPLY to return the result
+ * @param command command as same as received from the host
+ * @param length length of the command (MBIT_MORE_RADIO_COMMAND_SIZE at most)
+ */
+void MbitMoreRadio::sendCommand(uint32_t destination, uint8_t options, const uint8_t *command, size_t length) {
+  if (length == 0 || length > MBIT_MORE_RADIO_COMMAND_SIZE)
+    return;
+  uint8_t *packet = allocPacket();
+  encodeFrameHeader(packet, MbitMoreRadioFrameKind::COMMAND, 0);
+  uint8_t *payload = &packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE];
+  memcpy(&payload[0], &destination, 4);
+  payload[4] = options;
+  payload[5] = (uint8_t)length;
+  memcpy(&payload[6], command, length);
+  sendFrameTo(destination, packet, MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 6 + length);
+}
 
+/**
+ * @brief Run a command which was received from a gateway.
+ * The command is processed in the same way as received from the host.
+ * Result has [0..3] serial number of the gateway, [4..5] sequence number
+ * of the command frame and [6] whether the command was run.
+ *
+ * @param packet received frame of COMMAND
+ */
+void MbitMoreRadio::receiveCommand(const uint8_t *packet) {
+  const uint8_t *payload = &packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE];
+  uint32_t destination;
+  memcpy(&destination, &payload[0], 4);
+  if (destination != MBIT_MORE_RADIO_COMMAND_BROADCAST && destination != microbit_serial_number())
+    return;
+  uint8_t options = payload[4];
+  uint8_t length = payload[5];
+  // Header is copied before running the command which may yield
+  // and the packet pool may wrap around meanwhile.
+  uint32_t gateway = mbitMoreRadioPacketSerial(packet);
+  uint16_t sequence;
+  memcpy(&sequence, &packet[MBIT_MORE_RADIO_FRAME_SEQUENCE_INDEX], 2);
+  // Remote commands are not nested to avoid loops between gateways.
+  bool accepted = (length > 0 && length <= MBIT_MORE_RADIO_COMMAND_SIZE &&
+                   !((payload[6] >> 5) == MbitMoreCommand::CMD_RADIO &&
+                     (payload[6] & 0b11111) == MbitMoreRadioControlCommand::REMOTECOMMAND));
+  if (accepted) {
+    uint8_t command[MBIT_MORE_RADIO_COMMAND_SIZE];
+    memcpy(command, &payload[6], length);
+    mbitMore.onCommandReceived(command, length);
+  }
+  if (!(options & MBIT_MORE_RADIO_COMMAND_REPLY))
+    return;
+  uint8_t *result = allocPacket();
+  encodeFrameHeader(result, MbitMoreRadioFrameKind::RESULT, 0);
+  memcpy(&result[MBIT_MORE_RADIO_FRAME_HEADER_SIZE], &gateway, 4);
+  memcpy(&result[MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 4], &sequence, 2);
+  result[MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 6] = accepted ? 1 : 0;
+  sendrawpacket(result, MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 7);
+}
+
+/**
+ * @brief Pass a result of a command to the host.
+ * Result is sent as [0..3] serial number of the micro:bit which ran the command,
+ * [4..5] sequence number of the command frame and [6] whether the command was run.
+ *
+ * @param packet received frame of RESULT
+ */
+void MbitMoreRadio::receiveResult(const uint8_t *packet) {
+  const uint8_t *payload = &packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE];
+  uint32_t destination;
+  memcpy(&destination, &payload[0], 4);
+  if (destination != microbit_serial_number())
+    return;
+  uint32_t sender = mbitMoreRadioPacketSerial(packet);
+  uint8_t result[7];
+  memcpy(&result[0], &sender, 4);
+  memcpy(&result[4], &payload[4], 3);
+  notifyHost(0x0146, result, 7);
+}
+
+/**
+ * @brief Set the interval to broadcast telemetry of state and motion.
+ *
+ * @param interval interval [ms] or 0 to stop
+ */
+void MbitMoreRadio::setTelemetry(uint16_t interval) {
+  if (interval > 0 && interval < MBIT_MORE_RADIO_TELEMETRY_INTERVAL_MIN)
+    interval = MBIT_MORE_RADIO_TELEMETRY_INTERVAL_MIN;
+  telemetryInterval = interval;
+  if (telemetryInterval > 0 && !telemetryRunning) {
+    telemetryRunning = true;
+    create_fiber(startMbitMoreRadioTelemetry);
+  }
+}
+
+/**
+ * @brief Broadcast telemetry periodically until it was stopped.
+ * Data is the same as the characteristics of state and motion.
+ */
+void MbitMoreRadio::startTelemetry() {
+  uint8_t state[MM_CH_BUFFER_SIZE_STATE] = {0};
+  uint8_t lastState[MM_CH_BUFFER_SIZE_STATE] = {0};
+  uint32_t stateSentAt = 0;
+  uint8_t motion[MM_CH_BUFFER_SIZE_MOTION] = {0};
+  uint8_t lastMotion[MM_CH_BUFFER_SIZE_MOTION] = {0};
+  uint32_t motionSentAt = 0;
+  while (telemetryInterval > 0) {
+    mbitMore.updateState(state);
+    sendTelemetry(MbitMoreRadioFrameKind::TELEMETRY_STATE, state, lastState, MM_CH_BUFFER_SIZE_STATE, &stateSentAt);
+    mbitMore.updateMotion(motion);
+    sendTelemetry(MbitMoreRadioFrameKind::TELEMETRY_MOTION, motion, lastMotion, MM_CH_BUFFER_SIZE_MOTION, &motionSentAt);
+    fiber_sleep(telemetryInterval);
+  }
+  telemetryRunning = false;
+}
+
+/**
+ * @brief Broadcast a telemetry frame if the data changed or keepalive passed.
+ * Telemetry frame has [0..3] timestamp in the shared clock and the data.
+ *
+ * @param kind TELEMETRY_STATE or TELEMETRY_MOTION
+ * @param data current data
+ * @param lastData data which was sent last and is updated when sent
+ * @param length length of the data
+ * @param lastSentAt running time when sent last [ms] and is updated when sent
+ */
+void MbitMoreRadio::sendTelemetry(MbitMoreRadioFrameKind kind, const uint8_t *data, uint8_t *lastData, size_t length, uint32_t *lastSentAt) {
+  uint32_t now = (uint32_t)system_timer_current_time();
+  if (*lastSentAt != 0 && (now - *lastSentAt) < MBIT_MORE_RADIO_TELEMETRY_KEEPALIVE &&
+      memcmp(data, lastData, length) == 0)
+    return;
+  uint8_t *packet = allocPacket();
+  encodeFrameHeader(packet, kind, 0);
+  uint32_t timestamp = (uint32_t)sharedTime(localClock());
+  memcpy(&packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE], &timestamp, 4);
+  memcpy(&packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 4], data, length);
+  sendrawpacket(packet, MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 4 + length);
+  memcpy(lastData, data, length);
+  *lastSentAt = now;
+}
+
+/**
+ * @brief Pass a telemetry frame to the host.
+ * Telemetry is sent as [0..3] serial number of the sender, [4] kind of the frame,
+ * [5..8] timestamp in the shared clock and the data.
+ *
+ * @param packet received frame of TELEMETRY_STATE or TELEMETRY_MOTION
+ * @param length length of the data in the payload
+ */
+void MbitMoreRadio::receiveTelemetry(const uint8_t *packet, size_t length) {
+  uint8_t telemetry[5 + 4 + MM_CH_BUFFER_SIZE_MOTION];
+  uint32_t sender = mbitMoreRadioPacketSerial(packet);
+  memcpy(&telemetry[0], &sender, 4);
+  telemetry[4] = packet[MBIT_MORE_RADIO_FRAME_KIND_INDEX];
+  memcpy(&telemetry[5], &packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE], 4 + length);
+  notifyHost(0x0145, telemetry, 5 + 4 + length);
+}
+
+/**
+ * @brief Set the role in time synchronization.
+ *
+ * @param role role of this micro:bit
+ * @param interval interval to send beacons as the master [ms]
+ */
+void MbitMoreRadio::setTimeSync(MbitMoreRadioTimeSyncRole role, uint16_t interval) {
+  timeSyncRole = role;
+  beaconInterval = (interval < MBIT_MORE_RADIO_BEACON_INTERVAL_MIN) ? MBIT_MORE_RADIO_BEACON_INTERVAL_MIN : interval;
+  if (role != MbitMoreRadioTimeSyncRole::TIMESYNC_NODE) {
+    // Own clock is used until a beacon is received again.
+    timeSynced = false;
+    clockDrift = 0;
+  }
+  if (role == MbitMoreRadioTimeSyncRole::TIMESYNC_MASTER && !beaconRunning) {
+    beaconRunning = true;
+    create_fiber(startMbitMoreRadioBeacon);
+  }
+}
+
+/**
+ * @brief Send beacons periodically while this micro:bit is the master.
+ * Beacon has [0..7] clock of the master as uint64_t little-endian,
+ * [8] transmit power [dBm] as int8_t and [9..10] interval [ms] as uint16_t little-endian.
+ * Frames held for sleepy nodes are sent just after the beacon.
+ */
+void MbitMoreRadio::startBeacon() {
+  while (timeSyncRole == MbitMoreRadioTimeSyncRole::TIMESYNC_MASTER) {
+    uint8_t *packet = allocPacket();
+    encodeFrameHeader(packet, MbitMoreRadioFrameKind::BEACON, 0);
+    packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 8] = (uint8_t)radioPowerDbm[signalPower];
+    memcpy(&packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 9], &beaconInterval, 2);
+    // Clock is read at last to shorten the delay until sent.
+    uint64_t now = localClock();
+    memcpy(&packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE], &now, 8);
+    sendrawpacket(packet, MBIT_MORE_RADIO_FRAME_HEADER_SIZE + 11);
+    sendHeldFrames();
+    fiber_sleep(beaconInterval);
+  }
+  beaconRunning = false;
+}
+
+/**
+ * @brief Adjust the shared clock with a beacon from the master.
+ * Drift is estimated from the interval between beacons and smoothed
+ * with EWMA (alpha = 1/4) to reduce jitter of receiving.
+ * Offset is also corrected by 1/4 of the error from the predicted clock,
+ * or stepped when the error is too large to be jitter.
+ *
+ * @param packet received frame of BEACON
+ * @param receivedAt local clock when the beacon was received
+ */
+void MbitMoreRadio::receiveBeacon(const uint8_t *packet, uint64_t receivedAt) {
+  if (timeSyncRole != MbitMoreRadioTimeSyncRole::TIMESYNC_NODE)
+    return;
+  // Relayed beacons have unknown delay.
+  if (packet[MBIT_MORE_RADIO_FRAME_FLAGS_INDEX] & MBIT_MORE_RADIO_FRAME_RELAYED)
+    return;
+  uint64_t masterTime;
+  memcpy(&masterTime, &packet[MBIT_MORE_RADIO_FRAME_HEADER_SIZE], 8);
+  uint64_t syncedTime = masterTime;
+  if (timeSynced) {
+    int64_t localElapsed = (int64_t)(receivedAt - beaconLocalTime);
+    int64_t masterElapsed = (int64_t)(masterTime - beaconMasterTime);
+    if (localElapsed > 0) {
+      int64_t drift = (masterElapsed - localElapsed) * 1000000 / localElapsed;
+      // Outliers over 1000 ppm are beacons which were processed late.
+      if (drift > -1000 && drift < 1000) {
+        clockDrift += (int32_t)((drift - clockDrift) / 4);
+      }
+    }
+    uint64_t predicted = sharedTime(receivedAt);
+    int64_t error = (int64_t)(masterTime - predicted);
+    if (error > -(MBIT_MORE_RADIO_SYNC_STEP * MBIT_MORE_RADIO_CLOCK_PER_MS) &&
+        error < (MBIT_MORE_RADIO_SYNC_STEP * MBIT_MORE_RADIO_CLOCK_PER_MS)) {
+      syncedTime = predicted + error / 4;
+    }
+  }
+  beaconLocalTime = receivedAt;
+  beaconMasterTime = masterTime;
+  syncLocalTime = receivedAt;
+  syncMasterTime = syncedTime;
+  timeSynced = true;
+}
+
+/**
+ * @brief Return the local clock in the same unit as timestamps of events.
+ *
+ * @return uint64_t local clock [us] on v2 or [ms] on v1
+ */
+uint64_t MbitMoreRadio::localClock() {
+#if MICROBIT_CODAL
+  return system_timer_current_time_us();
+#else // NOT MICROBIT_CODAL
+  return system_timer_current_time();
+#endif // NOT MICROBIT_CODAL
+}
+
+/**
+ * @brief Convert a local timestamp to the clock shared with the master.
+ * The timestamp is returned as is until a beacon is received.
+ *
+ * @param localTime timestamp in the local clock
+ * @return uint64_t timestamp in the shared clock
+ */
+uint64_t MbitMoreRadio::sharedTime(uint64_t localTime) {
+  if (!timeSynced)
+    return localTime;
+  int64_t elapsed = (int64_t)(localTime - syncLocalTime);
+  return syncMasterTime + elapsed + (elapsed * clockDrift) / 1000000;
+}
+
+/**
+ * @brief Set adaptive transmit power.
+ *
+ * @param on true to adapt transmit power
+ * @param target RSSI which the receivers should see [dBm]
+ */
+void MbitMoreRadio::setAdaptivePower(bool on, int target) {
+  adaptivePower = on;
+  targetSignal = target;
+  worstPathLoss = -1;
+  if (adaptivePower && !adaptivePowerRunning) {
+    adaptivePowerRunning = true;
+    create_fiber(startMbitMoreRadioAdaptivePower);
+  }
+}
+
+/**
+ * @brief Take path loss of a link into the current period.
+ *
+ * @param txPower transmit power of the link [dBm]
+ * @param signal RSSI at the receiver [dBm]
+ */
+void MbitMoreRadio::feedbackSignal(int txPower, int signal) {
+  int pathLoss = txPower - signal;
+  if (pathLoss > worstPathLoss)
+    worstPathLoss = pathLoss;
+}
+
+/**
+ * @brief Re-evaluate transmit power periodically while adaptive power is on.
+ * Power is raised by a level when no feedback was received in the period
+ * because the link may have been lost.
+ */
+void MbitMoreRadio::startAdaptivePower() {
+  while (adaptivePower) {
+    fiber_sleep(MBIT_MORE_RADIO_POWER_PERIOD);
+    if (!adaptivePower)
+      break;
+    int level = MBIT_MORE_RADIO_POWER_LEVELS - 1;
+    if (worstPathLoss < 0) {
+      if (signalPower < level)
+        level = signalPower + 1;
+    } else {
+      for (int i = 0; i < MBIT_MORE_RADIO_POWER_LEVELS; i++) {
+        if (radioPowerDbm[i] - worstPathLoss >= targetSignal) {
+          level = i;
+          break;
+        }
+      }
+    }
+    if (level != signalPower)
+      Radiosetsignalpower(level);
+    worstPathLoss = -1;
+  }
+  adaptivePowerRunning = false;
+}
+
+/**
+ * @brief Set duty-cycled listening.
+ * The radio keeps listening until the first beacon is received.
+ *
+ * @param on true to listen only in windows after beacons
+ * @param window time to keep listening after a beacon [ms]
+ */
+void MbitMoreRadio::setDutyCycle(bool on, uint16_t window) {
+  dutyCycling = on;
+  listenWindow = (window > 0) ? window : MBIT_MORE_RADIO_LISTEN_WINDOW;
+  if (!dutyCycling) {
+    dutyAsleep = false;
+    updateRadioSleeping();
+    return;
+  }
+  if (!dutyCycleRunning) {
+    dutyCycleRunning = true;
+    create_fiber(startMbitMoreRadioDutyCycle);
+  }
+}
+
+/**
+ * @brief Switch the radio along beacons while duty-cycled listening is on.
+ * When a beacon is missed, the next window is aligned to the expected time
+ * and the radio stays on after beacons were missed several times in a row.
+ */
+void MbitMoreRadio::startDutyCycle() {
+  while (dutyCycling) {
+    uint32_t now = (uint32_t)system_timer_current_time();
+    if (beaconReceivedAt == 0 || missedBeacons >= MBIT_MORE_RADIO_MISSED_BEACONS_MAX) {
+      // Listen until a beacon is received.
+      dutyAsleep = false;
+      updateRadioSleeping();
+      fiber_sleep(listenWindow);
+      continue;
+    }
+    uint32_t listenUntil = beaconReceivedAt + listenWindow;
+    if ((int32_t)(listenUntil - now) > 0) {
+      fiber_sleep(listenUntil - now);
+      continue;
+    }
+    uint32_t lastBeacon = beaconReceivedAt;
+    uint32_t expectedAt = lastBeacon + beaconPeriod;
+    uint32_t wakeAt = expectedAt - MBIT_MORE_RADIO_LISTEN_GUARD;
+    if ((int32_t)(wakeAt - now) > 0) {
+      dutyAsleep = true;
+      updateRadioSleeping();
+      fiber_sleep(wakeAt - now);
+      if (!dutyCycling)
+        break;
+      dutyAsleep = false;
+      updateRadioSleeping();
+    }
+    fiber_sleep(MBIT_MORE_RADIO_LISTEN_GUARD * 2);
+    if (beaconReceivedAt == lastBeacon) {
+      beaconReceivedAt = expectedAt;
+      missedBeacons++;
+    }
+  }
+  dutyAsleep = false;
+  updateRadioSleeping();
+  dutyCycleRunning = false;
+}
+
+/**
+ * @brief Keep the radio listening until the time even while duty-cycled listening.
+ *
+ * @param until time to keep listening until [ms]
+ */
+void MbitMoreRadio::keepRadioAwake(uint32_t until) {
+  if ((int32_t)(until - keepAwakeUntil) > 0)
+    keepAwakeUntil = until;
+  updateRadioSleeping();
+}
+
+/**
+ * @brief Let the radio sleep when the duty cycle is off-window and nothing keeps it awake.
+ */
+void MbitMoreRadio::updateRadioSleeping() {
+  uint32_t now = (uint32_t)system_timer_current_time();
+  setRadioSleeping(dutyAsleep && (int32_t)(keepAwakeUntil - now) <= 0);
+}
+
+/**
+ * @brief Disable or enable the radio with the settings kept.
+ * enable() of the runtime resets the settings of the radio to the defaults.
+ *
+ * @param sleeping true to disable the radio
+ */
+void MbitMoreRadio::setRadioSleeping(bool sleeping) {
+  if (sleeping == radioSleeping)
+    return;
+  if (sleeping) {
+    uBit.radio.disable();
+    radioSleeping = true;
+    return;
+  }
+  uBit.radio.enable();
+  radioSleeping = false;
+  uBit.radio.setGroup(radioGroup);
+  uBit.radio.setTransmitPower(signalPower);
+  uBit.radio.setFrequencyBand(frequencyBand);
+  applyDataRate();
+}
+
+/**
+ * @brief Send a frame to a micro:bit or hold it until the listen window of the micro:bit.
+ * Frames are held only by the master because windows are aligned to its beacons.
+ * The frame is sent at once when all slots are in use.
+ *
+ * @param destination serial number of the destination
+ * @param frame frame to send
+ * @param length length of the frame
+ * @return true the frame was held
+ * @return false the frame was sent
+ */
+bool MbitMoreRadio::sendFrameTo(uint32_t destination, uint8_t *frame, size_t length) {
+  MbitMoreRadioNode *node = NULL;
+  if (timeSyncRole == MbitMoreRadioTimeSyncRole::TIMESYNC_MASTER &&
+      destination != MBIT_MORE_RADIO_COMMAND_BROADCAST) {
+    node = lookupNode(destination);
+  }
+  if (node != NULL && node->sleepy) {
+    for (size_t i = 0; i < MBIT_MORE_RADIO_HELD_SLOTS; i++) {
+      MbitMoreRadioHeldFrame *held = &heldFrames[i];
+      if (held->destination != 0)
+        continue;
+      held->destination = destination;
+      held->length = (uint8_t)length;
+      memcpy(held->frame, frame, length);
+      return true;
+    }
+  }
+  sendrawpacket(frame, length);
+  return false;
+}
+
+/**
+ * @brief Send frames which were held for sleepy nodes.
+ */
+void MbitMoreRadio::sendHeldFrames() {
+  for (size_t i = 0; i < MBIT_MORE_RADIO_HELD_SLOTS; i++) {
+    MbitMoreRadioHeldFrame *held = &heldFrames[i];
+    if (held->destination == 0)
+      continue;
+    sendrawpacket(held->frame, held->length);
+    held->destination = 0;
+  }
+}
+
+/**
+ * @brief Send data to the host if it was connected via serial.
+ *
+ * @param ch characteristic to notify
+ * @param data buffer to send
+ * @param length length of the buffer
+ */
+void MbitMoreRadio::notifyHost(uint16_t ch, uint8_t *data, size_t length) {
+#if MBIT_MORE_USE_SERIAL
+  if (mbitMore.serialConnected) {
+    mbitMore.serialService->notifyOnSerial(ch, data, length);
+  }
+#endif // MBIT_MORE_USE_SERIAL
+}
+
+/**
+ * @brief Count senders in the node table.
+ *
+ * @return size_t number of senders
+ */
+size_t MbitMoreRadio::nodeCount() {
+  size_t count = 0;
+  for (size_t i = 0; i < MBIT_MORE_RADIO_NODE_TABLE_SIZE; i++) {
+    if (nodeTable[i].serial != 0)
+      count++;
+  }
+  return count;
+}
+
+/**
+ * @brief Make a record of a sender in the node table.
+ *
+ * @param index index of the sender in order of the table
+ * @param record buffer of MBIT_MORE_RADIO_NODE_RECORD_SIZE bytes
+ */
+void MbitMoreRadio::nodeRecord(size_t index, uint8_t *record) {
+  memset(record, 0, MBIT_MORE_RADIO_NODE_RECORD_SIZE);
+  record[1] = (uint8_t)nodeCount();
+  size_t found = 0;
+  for (size_t i = 0; i < MBIT_MORE_RADIO_NODE_TABLE_SIZE; i++) {
+    MbitMoreRadioNode *node = &nodeTable[i];
+    if (node->serial == 0)
+      continue;
+    if (found++ < index)
+      continue;
+    record[0] = (uint8_t)index;
+    memcpy(&record[2], &node->serial, 4);
+    uint32_t elapsed = (uint32_t)system_timer_current_time() - node->lastSeen;
+    memcpy(&record[6], &elapsed, 4);
+    memcpy(&record[10], &node->packets, 2);
+    memcpy(&record[12], &node->lost, 2);
+    record[14] = (uint8_t)(int8_t)(node->rssiAverage / 16);
+    record[15] = (uint8_t)node->rssiMin;
+    record[16] = (uint8_t)node->rssiMax;
+    return;
+  }
+}
+
+/**
+ * @brief Send a packet of text as MakeCode radio string.
+ *
+ * @param text text to send
+ * @param length length of the text
+ */
+void MbitMoreRadio::sendString(const uint8_t *text, size_t length) {
+  uint8_t *packet = allocPacket();
+  size_t packetSize = MbitMoreRadioPacketCodec<MbitMoreRadioStringLayout>::encode(packet, NULL, text, length);
+  sendrawpacket(packet, packetSize);
+}
+
+/**
+ * @brief Send a packet of int32_t as MakeCode radio number.
+ *
+ * @param number number as int32_t little-endian
+ */
+void MbitMoreRadio::sendIntNumber(const uint8_t *number) {
+  uint8_t *packet = allocPacket();
+  size_t packetSize = MbitMoreRadioPacketCodec<MbitMoreRadioNumberLayout>::encode(packet, number, NULL, 0);
+  sendrawpacket(packet, packetSize);
+}
+
+/**
+ * @brief Send a packet of double as MakeCode radio number.
+ *
+ * @param number number as double little-endian
+ */
+void MbitMoreRadio::sendDoubleNumber(const uint8_t *number) {
+  uint8_t *packet = allocPacket();
+  size_t packetSize = MbitMoreRadioPacketCodec<MbitMoreRadioDoubleLayout>::encode(packet, number, NULL, 0);
+  sendrawpacket(packet, packetSize);
+}
+
+/**
+ * @brief Send a packet of double with name as MakeCode radio value.
+ *
+ * @param number number as double little-endian
+ * @param name name of the value
+ * @param nameLength length of the name
+ */
+void MbitMoreRadio::sendValue(const uint8_t *number, const uint8_t *name, size_t nameLength) {
+  uint8_t *packet = allocPacket();
+  size_t packetSize = MbitMoreRadioPacketCodec<MbitMoreRadioDoubleValueLayout>::encode(packet, number, name, nameLength);
+  sendrawpacket(packet, packetSize);
+}
+
+MbitMoreRadio::~MbitMoreRadio() {
+}
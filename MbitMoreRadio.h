@@ -6,69 +6,963 @@
 
 #include "pxt.h"
 
-
-
 class MbitMoreDevice;
 
-
 enum MbitMoreRadioPacketState
 {
-    NUM = 0x00,
-    STRING_AND_NUMBER = 0x01,
-    STRING  = 0x02,
-    info = 0x03 , //not use
-    DOUBLE = 0x04,
-    value = 0x05
-   
-
-}; 
+  NUM = 0x00,
+  STRING_AND_NUMBER = 0x01,
+  STRING = 0x02,
+  info = 0x03, //not use
+  DOUBLE = 0x04,
+  value = 0x05,
+  FRAME = 0x10 // frame of Microbit More protocol
+};
 
 enum MbitMoreRadioControlCommand
-{ SETGROUP = 0,
+{
+  SETGROUP = 0,
   SETSIGNALPOWER = 1,
   SENDSTRING = 2,
   SENDINTNUMBER = 3,
   SENDVALUE = 4,
   SENDDOUBLENUMBER = 5,
-  GETLASTPACKETSIGNAL = 6
+  GETLASTPACKETSIGNAL = 6,
+  SETBRIDGE = 7, // update labeled data with received packets
+  SETFREQUENCYBAND = 8,
+  SETDATARATE = 9,
+  SETQUEUEDEPTH = 10,
+  SENDMESSAGE = 11, // send payload over RADIOPACKETSIZE in fragments
+  SENDRELIABLE = 12, // send payload to a micro:bit with ack and retransmit
+  SETRELAY = 13, // rebroadcast frames from other micro:bits
+  REMOTECOMMAND = 14, // run a command on other micro:bits
+  SETTELEMETRY = 15, // broadcast state and motion periodically
+  SETTIMESYNC = 16, // share the clock of the master
+  SETADAPTIVEPOWER = 17, // lower transmit power to keep the target signal
+  SETDUTYCYCLE = 18 // listen only in windows after beacons
+};
 
+/**
+ * @brief Kind of the frame of Microbit More protocol.
+ */
+enum MbitMoreRadioFrameKind
+{
+  FRAGMENT = 0x01,
+  RELIABLE = 0x02,
+  ACK = 0x03,
+  COMMAND = 0x04,
+  RESULT = 0x05,
+  TELEMETRY_STATE = 0x06,
+  TELEMETRY_MOTION = 0x07,
+  BEACON = 0x08
+};
+
+/**
+ * @brief Role in time synchronization.
+ */
+enum MbitMoreRadioTimeSyncRole
+{
+  TIMESYNC_OFF = 0,
+  TIMESYNC_MASTER = 1,
+  TIMESYNC_NODE = 2
+};
+
+/**
+ * @brief Result of reliable delivery reported to the host.
+ */
+enum MbitMoreRadioDeliveryStatus
+{
+  DELIVERY_FAILED = 0,
+  DELIVERED = 1
+};
+
+enum MbitMoreRadioDataRate
+{
+  RADIO_1MBPS = 0,
+  RADIO_2MBPS = 1
 };
 
-#define RADIOPACKETSIZE  32 
-#define RADIOSENDPACKETSIZE 36
+#define RADIOPACKETSIZE 32
+#define RADIOSENDPACKETSIZE 36 // [0..31]=radio packet [32..35]=RSSI
+
+#define PACKETSTATEINFO 0
+
+/**
+ * @brief Number of packet buffers which are reused for sending and receiving.
+ */
+#define MBIT_MORE_RADIO_PACKET_POOL_SIZE 4
+
+/**
+ * @brief Default number of datagrams to be forwarded to the host for a receiving event.
+ */
+#define MBIT_MORE_RADIO_QUEUE_DEPTH 4
+
+/**
+ * @brief Capacity of the node table which must be power of two.
+ */
+#define MBIT_MORE_RADIO_NODE_TABLE_SIZE 16
+#define MBIT_MORE_RADIO_NODE_RECORD_SIZE 17
+
+/**
+ * @brief Max size of a message which is sent in fragments.
+ * Fragments of a message must be 8 at most to be tracked in a byte.
+ */
+#define MBIT_MORE_RADIO_MESSAGE_SIZE 128
+#define MBIT_MORE_RADIO_FRAGMENT_DATA_SIZE 19
+#define MBIT_MORE_RADIO_REASSEMBLY_SLOTS 2
+#define MBIT_MORE_RADIO_REASSEMBLY_TIMEOUT 1000 // [ms]
+#define MBIT_MORE_RADIO_FRAGMENT_INTERVAL 6 // [ms] to let receivers drain their RX queue
+#if MICROBIT_CODAL
+#define MBIT_MORE_RADIO_OUTGOING_SLOTS 2
+#else // NOT MICROBIT_CODAL
+#define MBIT_MORE_RADIO_OUTGOING_SLOTS 1
+#endif // NOT MICROBIT_CODAL
+
+/**
+ * @brief Message which is being reassembled from fragments.
+ */
+typedef struct {
+  uint32_t serial;                              /** serial number of the sender, 0 is free */
+  uint8_t messageID;                            /** ID of the message in the sender */
+  uint8_t count;                                /** count of fragments */
+  uint8_t receivedMask;                         /** bits of received fragments */
+  uint8_t length;                               /** length of the message */
+  uint32_t startedAt;                           /** running time when the first fragment received [ms] */
+  uint8_t data[MBIT_MORE_RADIO_MESSAGE_SIZE];   /** content of the message */
+} MbitMoreRadioReassembly;
+
+/**
+ * @brief Message which is waiting to send the rest of its fragments.
+ */
+typedef struct {
+  uint8_t messageID;                            /** ID of the message */
+  uint8_t count;                                /** count of fragments */
+  uint8_t nextIndex;                            /** index of the fragment to send next */
+  uint8_t length;                               /** length of the message */
+  uint8_t data[MBIT_MORE_RADIO_MESSAGE_SIZE];   /** content of the message */
+} MbitMoreRadioOutgoingMessage;
+
+/**
+ * @brief Reliable delivery with ack and retransmit.
+ * Interval of retransmit is doubled from the initial timeout with random jitter.
+ */
+#define MBIT_MORE_RADIO_RELIABLE_DATA_SIZE 16
+#define MBIT_MORE_RADIO_RELIABLE_SLOTS 4
+#define MBIT_MORE_RADIO_RELIABLE_TIMEOUT 20 // [ms]
+#define MBIT_MORE_RADIO_RELIABLE_RETRIES 5
+#define MBIT_MORE_RADIO_RELIABLE_WINDOW 32 // count of sequence numbers kept for each sender
+
+/**
+ * @brief Frame which is waiting for ack.
+ */
+typedef struct {
+  uint32_t destination;             /** serial number of the destination, 0 is free */
+  uint16_t sequence;                /** reliable sequence number of the frame */
+  uint8_t retries;                  /** count of retransmits */
+  uint16_t timeout;                 /** interval to the next retransmit [ms] */
+  uint32_t retransmitAt;            /** running time to retransmit [ms] */
+  uint8_t length;                   /** length of the frame */
+  uint8_t frame[RADIOPACKETSIZE];   /** frame to retransmit */
+} MbitMoreRadioPendingFrame;
+
+/**
+ * @brief Command which is run on other micro:bits.
+ * Destination 0 is broadcast to all micro:bits in the group.
+ */
+#define MBIT_MORE_RADIO_COMMAND_SIZE 17
+#define MBIT_MORE_RADIO_COMMAND_BROADCAST 0
+#define MBIT_MORE_RADIO_COMMAND_REPLY 0x01 // option to return the result
+
+/**
+ * @brief Telemetry of state and motion which is broadcast periodically.
+ * Unchanged data is suppressed until the keepalive interval passed.
+ */
+#define MBIT_MORE_RADIO_TELEMETRY_KEEPALIVE 1000 // [ms]
+#define MBIT_MORE_RADIO_TELEMETRY_INTERVAL_MIN 20 // [ms]
+
+/**
+ * @brief Time synchronization with beacons from the master.
+ * Clock is in the same unit as timestamps of events ([us] on v2, [ms] on v1).
+ */
+#define MBIT_MORE_RADIO_BEACON_INTERVAL 1000 // [ms]
+#define MBIT_MORE_RADIO_BEACON_INTERVAL_MIN 100 // [ms]
+#define MBIT_MORE_RADIO_SYNC_STEP 50 // [ms] offset error to step the clock instead of smoothing
+#if MICROBIT_CODAL
+#define MBIT_MORE_RADIO_CLOCK_PER_MS 1000
+#else // NOT MICROBIT_CODAL
+#define MBIT_MORE_RADIO_CLOCK_PER_MS 1
+#endif // NOT MICROBIT_CODAL
+
+/**
+ * @brief Adaptive transmit power with RSSI feedback in acks and beacons.
+ * Power level is re-evaluated to be the lowest one which reaches the target signal
+ * on the worst link seen in the period.
+ */
+#define MBIT_MORE_RADIO_POWER_LEVELS 8
+#define MBIT_MORE_RADIO_POWER_PERIOD 5000 // [ms]
+#define MBIT_MORE_RADIO_TARGET_SIGNAL -80 // [dBm]
+
+/**
+ * @brief Duty-cycled listening which is aligned to beacons of the master.
+ * The radio wakes up before the expected beacon and sleeps after the listen window.
+ * The master holds frames for sleepy nodes and sends them after the beacon.
+ */
+#define MBIT_MORE_RADIO_LISTEN_WINDOW 50 // [ms]
+#define MBIT_MORE_RADIO_LISTEN_GUARD 10 // [ms]
+#define MBIT_MORE_RADIO_MISSED_BEACONS_MAX 4
+#define MBIT_MORE_RADIO_HELD_SLOTS 4
+
+/**
+ * @brief Frame which is held for a sleepy node until its listen window.
+ */
+typedef struct {
+  uint32_t destination;             /** serial number of the destination, 0 is free */
+  uint8_t length;                   /** length of the frame */
+  uint8_t frame[RADIOPACKETSIZE];   /** frame to send */
+} MbitMoreRadioHeldFrame;
+
+/**
+ * @brief Relay of frames to reach micro:bits out of range.
+ * Duplicates are suppressed with a cache of hashes of (sender, sequence number).
+ */
+#define MBIT_MORE_RADIO_RELAY_TTL 3
+#define MBIT_MORE_RADIO_RELAY_SLOTS 4
+#define MBIT_MORE_RADIO_RELAY_JITTER 16 // [ms]
+#define MBIT_MORE_RADIO_SEEN_CACHE_SIZE 32
+
+/**
+ * @brief Frame which is waiting to be relayed.
+ */
+typedef struct {
+  bool waiting;                     /** whether the frame is waiting */
+  uint8_t length;                   /** length of the frame as received */
+  uint32_t sendAt;                  /** running time to send [ms] */
+  uint8_t frame[RADIOPACKETSIZE];   /** frame to send */
+} MbitMoreRadioRelayFrame;
+
+/**
+ * @brief Statistics of a sender in the node table.
+ */
+typedef struct {
+  uint32_t serial;       /** serial number of the sender, 0 is empty */
+  uint32_t lastSeen;     /** running time when received last [ms] */
+  uint16_t packets;      /** count of received packets */
+  uint16_t lost;         /** count of lost frames estimated from sequence gaps */
+  uint16_t sequence;     /** sequence number of the last frame */
+  bool hasSequence;      /** whether a frame with sequence number was received */
+  int16_t rssiAverage;   /** EWMA of RSSI multiplied by 16 [dBm] */
+  int8_t rssiMin;        /** min RSSI [dBm] */
+  int8_t rssiMax;        /** max RSSI [dBm] */
+  bool sleepy;           /** whether the node listens only after beacons */
+  uint16_t reliableSequence; /** reliable sequence number to send to the node next */
+  uint16_t reliableLast;     /** newest reliable sequence number received from the node */
+  uint32_t reliableWindow;   /** bit n is set when reliableLast - n was received */
+  bool hasReliable;          /** whether a reliable frame was received from the node */
+} MbitMoreRadioNode;
+
+/**
+ * Class definition for radio communication of Microbit More.
+ *
+ */
+class MbitMoreRadio {
+private:
+  /**
+   * @brief Preallocated packet buffers to send without heap allocation and to keep received packets.
+   * Each slot has room for the RSSI after the radio packet.
+   * Receiving still takes a PacketBuffer of the runtime for each datagram,
+   * which is the only API to get RSSI of the datagram itself.
+   */
+  uint8_t packetPool[MBIT_MORE_RADIO_PACKET_POOL_SIZE][RADIOSENDPACKETSIZE] = {{0}};
+
+  /**
+   * @brief Index of the slot in the pool to be used next.
+   */
+  size_t packetPoolNext = 0;
+
+  /**
+   * @brief Open-addressing table of senders keyed by serial number.
+   */
+  MbitMoreRadioNode nodeTable[MBIT_MORE_RADIO_NODE_TABLE_SIZE] = {{0}};
+
+  /**
+   * @brief Sequence number of the frame to be sent next.
+   */
+  uint16_t frameSequence = 0;
+
+  /**
+   * @brief Data rate on the air.
+   */
+  MbitMoreRadioDataRate dataRate = MbitMoreRadioDataRate::RADIO_1MBPS;
+
+  /**
+   * @brief RSSI of the last received packet [dBm].
+   */
+  int lastSignal = 0;
+
+  /**
+   * @brief Set the data rate to the radio peripheral which was enabled.
+   */
+  void applyDataRate();
+
+  /**
+   * @brief ID of the message to be sent next in fragments.
+   */
+  uint8_t messageID = 0;
+
+  /**
+   * @brief Ring of messages waiting to send the rest of their fragments.
+   */
+  MbitMoreRadioOutgoingMessage outgoing[MBIT_MORE_RADIO_OUTGOING_SLOTS];
+
+  /**
+   * @brief Count of messages put in the outgoing ring.
+   */
+  volatile uint32_t outgoingHead = 0;
+
+  /**
+   * @brief Count of messages finished in the outgoing ring.
+   */
+  volatile uint32_t outgoingTail = 0;
+
+  /**
+   * @brief Whether the fiber to send fragments is running.
+   */
+  bool fragmentingRunning = false;
+
+  /**
+   * @brief Send a fragment of a message.
+   *
+   * @param data content of the message
+   * @param length length of the message
+   * @param id ID of the message
+   * @param index index of the fragment
+   * @param count count of fragments
+   */
+  void sendFragment(const uint8_t *data, size_t length, uint8_t id, uint8_t index, uint8_t count);
+
+  /**
+   * @brief Buffers to reassemble messages from fragments.
+   */
+  MbitMoreRadioReassembly reassembly[MBIT_MORE_RADIO_REASSEMBLY_SLOTS] = {{0}};
+
+  /**
+   * @brief Reassemble a message with a received fragment.
+   *
+   * @param packet received frame of FRAGMENT
+   */
+  void receiveFragment(const uint8_t *packet);
+
+  /**
+   * @brief Send data to the host if it was connected via serial.
+   *
+   * @param ch characteristic to notify
+   * @param data buffer to send
+   * @param length length of the buffer
+   */
+  void notifyHost(uint16_t ch, uint8_t *data, size_t length);
+
+  /**
+   * @brief Update the node table with a received packet.
+   *
+   * @param packet received packet
+   * @param signal RSSI of the packet [dBm]
+   */
+  void updateNode(const uint8_t *packet, int signal);
+
+  /**
+   * @brief Find the entry of the sender in the node table.
+   *
+   * @param serial serial number of the sender
+   * @return MbitMoreRadioNode* entry of the sender or NULL when not in the table
+   */
+  MbitMoreRadioNode *lookupNode(uint32_t serial);
+
+  /**
+   * @brief Find or add the entry of the sender in the node table.
+   * A cleared entry is assigned when the sender is not in the table.
+   *
+   * @param serial serial number of the sender
+   * @return MbitMoreRadioNode* entry of the sender
+   */
+  MbitMoreRadioNode *addNode(uint32_t serial);
+
+  /**
+   * @brief Frames which are waiting for ack.
+   */
+  MbitMoreRadioPendingFrame pendingFrames[MBIT_MORE_RADIO_RELIABLE_SLOTS] = {{0}};
+
+  /**
+   * @brief Whether the fiber to retransmit is running.
+   */
+  bool retransmitting = false;
+
+  /**
+   * @brief Receive a reliable frame, send ack and pass it to the host.
+   *
+   * @param packet received frame of RELIABLE
+   */
+  void receiveReliable(const uint8_t *packet);
+
+  /**
+   * @brief Check the reliable frame was received from the node already and remember it.
+   *
+   * @param node entry of the sender in the node table
+   * @param sequence reliable sequence number of the frame
+   * @return true the frame is a duplicate
+   * @return false the frame is new
+   */
+  bool isSeenReliable(MbitMoreRadioNode *node, uint16_t sequence);
+
+  /**
+   * @brief Finish the pending frame which was acknowledged.
+   *
+   * @param packet received frame of ACK
+   */
+  void receiveAck(const uint8_t *packet);
+
+  /**
+   * @brief Report the result of reliable delivery to the host.
+   *
+   * @param pending frame which finished
+   * @param status result of the delivery
+   */
+  void reportDelivery(MbitMoreRadioPendingFrame *pending, MbitMoreRadioDeliveryStatus status);
+
+  /**
+   * @brief Whether frames from other micro:bits are relayed.
+   */
+  bool relaying = false;
+
+  /**
+   * @brief TTL of frames which are sent from this micro:bit.
+   */
+  uint8_t frameTTL = MBIT_MORE_RADIO_RELAY_TTL;
+
+  /**
+   * @brief Ring of hashes of frames which were received already.
+   */
+  uint32_t seenFrames[MBIT_MORE_RADIO_SEEN_CACHE_SIZE] = {0};
+
+  /**
+   * @brief Index of the hash in the ring to be overwritten next.
+   */
+  size_t seenFramesNext = 0;
+
+  /**
+   * @brief Frames which are waiting to be relayed.
+   */
+  MbitMoreRadioRelayFrame relayFrames[MBIT_MORE_RADIO_RELAY_SLOTS] = {{0}};
 
-#define PACKETSTATEINFO  0
+  /**
+   * @brief Whether the fiber to relay is running.
+   */
+  bool relayRunning = false;
 
+  /**
+   * @brief Check the frame was received already and remember it.
+   *
+   * @param packet received frame
+   * @return true the frame is a duplicate
+   * @return false the frame is new
+   */
+  bool isSeenFrame(const uint8_t *packet);
 
-class  MbitMoreRadio {
-    private:
+  /**
+   * @brief Return the destination of the frame.
+   *
+   * @param packet received frame
+   * @return uint32_t serial number of the destination or MBIT_MORE_RADIO_COMMAND_BROADCAST
+   */
+  uint32_t frameDestination(const uint8_t *packet);
 
- 
+  /**
+   * @brief Schedule to relay the frame after random jitter.
+   *
+   * @param packet received frame
+   * @param length length of the frame
+   */
+  void relayFrame(const uint8_t *packet, size_t length);
+
+  /**
+   * @brief Run a command which was received from a gateway.
+   *
+   * @param packet received frame of COMMAND
+   */
+  void receiveCommand(const uint8_t *packet);
+
+  /**
+   * @brief Pass a result of a command to the host.
+   *
+   * @param packet received frame of RESULT
+   */
+  void receiveResult(const uint8_t *packet);
+
+  /**
+   * @brief Interval to broadcast telemetry [ms], 0 is off.
+   */
+  uint16_t telemetryInterval = 0;
+
+  /**
+   * @brief Whether the fiber to broadcast telemetry is running.
+   */
+  bool telemetryRunning = false;
+
+  /**
+   * @brief Broadcast a telemetry frame if the data changed or keepalive passed.
+   *
+   * @param kind TELEMETRY_STATE or TELEMETRY_MOTION
+   * @param data current data
+   * @param lastData data which was sent last and is updated when sent
+   * @param length length of the data
+   * @param lastSentAt running time when sent last [ms] and is updated when sent
+   */
+  void sendTelemetry(MbitMoreRadioFrameKind kind, const uint8_t *data, uint8_t *lastData, size_t length, uint32_t *lastSentAt);
+
+  /**
+   * @brief Pass a telemetry frame to the host.
+   *
+   * @param packet received frame of TELEMETRY_STATE or TELEMETRY_MOTION
+   * @param length length of the data in the payload
+   */
+  void receiveTelemetry(const uint8_t *packet, size_t length);
+
+  /**
+   * @brief Role of this micro:bit in time synchronization.
+   */
+  MbitMoreRadioTimeSyncRole timeSyncRole = MbitMoreRadioTimeSyncRole::TIMESYNC_OFF;
+
+  /**
+   * @brief Interval to send beacons as the master [ms].
+   */
+  uint16_t beaconInterval = MBIT_MORE_RADIO_BEACON_INTERVAL;
+
+  /**
+   * @brief Whether the fiber to send beacons is running.
+   */
+  bool beaconRunning = false;
+
+  /**
+   * @brief Whether a beacon was received as a node.
+   */
+  bool timeSynced = false;
+
+  /**
+   * @brief Local clock of the point to convert to the shared clock.
+   */
+  uint64_t syncLocalTime = 0;
+
+  /**
+   * @brief Clock of the master at the point which was smoothed over beacons.
+   */
+  uint64_t syncMasterTime = 0;
+
+  /**
+   * @brief Local clock when the last beacon was received.
+   */
+  uint64_t beaconLocalTime = 0;
+
+  /**
+   * @brief Clock of the master in the last beacon.
+   */
+  uint64_t beaconMasterTime = 0;
+
+  /**
+   * @brief Drift of the master against the local clock [ppm].
+   */
+  int32_t clockDrift = 0;
+
+  /**
+   * @brief Adjust the shared clock with a beacon from the master.
+   *
+   * @param packet received frame of BEACON
+   * @param receivedAt local clock when the beacon was received
+   */
+  void receiveBeacon(const uint8_t *packet, uint64_t receivedAt);
+
+  /**
+   * @brief Current transmit power level (0 - 7).
+   */
+  int signalPower = 7;
+
+  /**
+   * @brief Whether transmit power is adapted with RSSI feedback.
+   */
+  bool adaptivePower = false;
+
+  /**
+   * @brief Whether the fiber to adapt transmit power is running.
+   */
+  bool adaptivePowerRunning = false;
+
+  /**
+   * @brief RSSI which the receivers should see [dBm].
+   */
+  int targetSignal = MBIT_MORE_RADIO_TARGET_SIGNAL;
+
+  /**
+   * @brief Worst path loss in the current period [dB], -1 is no feedback.
+   */
+  int worstPathLoss = -1;
+
+  /**
+   * @brief Take path loss of a link into the current period.
+   *
+   * @param txPower transmit power of the link [dBm]
+   * @param signal RSSI at the receiver [dBm]
+   */
+  void feedbackSignal(int txPower, int signal);
+
+  /**
+   * @brief Group which was set to the radio.
+   */
+  int radioGroup = 0;
+
+  /**
+   * @brief Frequency band which was set to the radio.
+   */
+  int frequencyBand = MICROBIT_RADIO_DEFAULT_FREQUENCY;
+
+  /**
+   * @brief Whether this micro:bit listens only in windows after beacons.
+   */
+  bool dutyCycling = false;
+
+  /**
+   * @brief Whether the fiber of duty cycle is running.
+   */
+  bool dutyCycleRunning = false;
+
+  /**
+   * @brief Whether the radio was disabled to save power.
+   */
+  bool radioSleeping = false;
+
+  /**
+   * @brief Whether the duty cycle is out of the listen window.
+   */
+  bool dutyAsleep = false;
+
+  /**
+   * @brief Time to keep the radio listening until for acks [ms].
+   */
+  uint32_t keepAwakeUntil = 0;
+
+  /**
+   * @brief Time to keep listening after a beacon [ms].
+   */
+  uint16_t listenWindow = MBIT_MORE_RADIO_LISTEN_WINDOW;
+
+  /**
+   * @brief Running time when the last beacon was received or expected [ms], 0 is not yet.
+   */
+  uint32_t beaconReceivedAt = 0;
+
+  /**
+   * @brief Interval of beacons which the master announced [ms].
+   */
+  uint16_t beaconPeriod = MBIT_MORE_RADIO_BEACON_INTERVAL;
+
+  /**
+   * @brief Count of beacons which were not received in a row.
+   */
+  uint8_t missedBeacons = 0;
+
+  /**
+   * @brief Frames which are held for sleepy nodes.
+   */
+  MbitMoreRadioHeldFrame heldFrames[MBIT_MORE_RADIO_HELD_SLOTS] = {{0}};
+
+  /**
+   * @brief Disable or enable the radio with the settings kept.
+   *
+   * @param sleeping true to disable the radio
+   */
+  void setRadioSleeping(bool sleeping);
+
+  /**
+   * @brief Keep the radio listening until the time even while duty-cycled listening.
+   *
+   * @param until time to keep listening until [ms]
+   */
+  void keepRadioAwake(uint32_t until);
+
+  /**
+   * @brief Let the radio sleep when the duty cycle is off-window and nothing keeps it awake.
+   */
+  void updateRadioSleeping();
+
+  /**
+   * @brief Send a frame to a micro:bit or hold it until the listen window of the micro:bit.
+   *
+   * @param destination serial number of the destination
+   * @param frame frame to send
+   * @param length length of the frame
+   * @return true the frame was held
+   * @return false the frame was sent
+   */
+  bool sendFrameTo(uint32_t destination, uint8_t *frame, size_t length);
+
+  /**
+   * @brief Send frames which were held for sleepy nodes.
+   */
+  void sendHeldFrames();
 
-   
 public:
+  MbitMoreDevice &mbitMore;
 
-MbitMoreDevice &mbitMore;
+  /**
+   * @brief Construct a new MbitMoreRadio object and enable the radio.
+   *
+   * @param _mbitMore An instance of Microbit More device controller
+   */
+  MbitMoreRadio(MbitMoreDevice &_mbitMore);
 
- MbitMoreRadio(MbitMoreDevice &_mbitMore);
-  uint8_t RECEIVEDLASTPACKET[RADIOPACKETSIZE] ;
+  uint8_t RECEIVEDLASTPACKET[RADIOPACKETSIZE];
+
+  /**
+   * @brief Max number of datagrams to be forwarded to the host for a receiving event.
+   * Datagrams over this depth are dropped to keep latency of forwarding,
+   * while frames of Microbit More protocol are always processed.
+   */
+  size_t queueDepth = MBIT_MORE_RADIO_QUEUE_DEPTH;
 
   void Radiosetgroup(int group);
 
   void Radiosetsignalpower(int signalpower);
 
+  /**
+   * @brief Set adaptive transmit power.
+   *
+   * @param on true to adapt transmit power
+   * @param target RSSI which the receivers should see [dBm]
+   */
+  void setAdaptivePower(bool on, int target);
 
-  void sendrawpacket(uint8_t buf[],int len);
+  /**
+   * @brief Re-evaluate transmit power periodically while adaptive power is on.
+   */
+  void startAdaptivePower();
 
+  /**
+   * @brief Set duty-cycled listening.
+   *
+   * @param on true to listen only in windows after beacons
+   * @param window time to keep listening after a beacon [ms]
+   */
+  void setDutyCycle(bool on, uint16_t window);
 
-  ~MbitMoreRadio();
+  /**
+   * @brief Switch the radio along beacons while duty-cycled listening is on.
+   */
+  void startDutyCycle();
+
+  /**
+   * @brief Set the frequency band.
+   *
+   * @param band frequency band in the range 0 - 83 (2400 + band [MHz])
+   */
+  void setFrequencyBand(int band);
+
+  /**
+   * @brief Set the data rate on the air.
+   * All micro:bits in the group must use the same data rate.
+   *
+   * @param rate data rate to set
+   */
+  void setDataRate(MbitMoreRadioDataRate rate);
+
+  /**
+   * @brief Return RSSI of the last received packet.
+   *
+   * @return int RSSI [dBm]
+   */
+  int lastPacketSignal();
+
+  /**
+   * @brief Take a cleared packet buffer from the pool.
+   * The buffer stays valid until the pool wraps around.
+   *
+   * @return uint8_t* buffer of RADIOSENDPACKETSIZE bytes
+   */
+  uint8_t *allocPacket();
+
+  /**
+   * @brief Send the packet without copying it into a heap buffer.
+   *
+   * @param buf packet to send
+   * @param len length of the packet
+   */
+  void sendrawpacket(uint8_t buf[], int len);
+
+  /**
+   * @brief Receive a datagram into a buffer of the pool.
+   * [0..31] is the radio packet and [32..35] is the RSSI as int32_t big-endian.
+   *
+   * @param length length of the received datagram
+   * @return uint8_t* received packet or NULL when no datagram is waiting
+   */
+  uint8_t *receivePacket(size_t *length);
+
+  /**
+   * @brief Send a packet of text as MakeCode radio string.
+   *
+   * @param text text to send
+   * @param length length of the text
+   */
+  void sendString(const uint8_t *text, size_t length);
+
+  /**
+   * @brief Send a packet of int32_t as MakeCode radio number.
+   *
+   * @param number number as int32_t little-endian
+   */
+  void sendIntNumber(const uint8_t *number);
 
-  
+  /**
+   * @brief Send a packet of double as MakeCode radio number.
+   *
+   * @param number number as double little-endian
+   */
+  void sendDoubleNumber(const uint8_t *number);
 
- 
+  /**
+   * @brief Send a packet of double with name as MakeCode radio value.
+   *
+   * @param number number as double little-endian
+   * @param name name of the value
+   * @param nameLength length of the name
+   */
+  void sendValue(const uint8_t *number, const uint8_t *name, size_t nameLength);
 
+  /**
+   * @brief Write the header of a Microbit More frame with the next sequence number.
+   *
+   * @param packet buffer to write
+   * @param kind kind of the frame
+   * @param flags flags of the frame
+   */
+  void encodeFrameHeader(uint8_t *packet, uint8_t kind, uint8_t flags);
 
+  /**
+   * @brief Process a received frame of Microbit More protocol.
+   *
+   * @param packet received frame
+   * @param length length of the frame
+   * @param receivedAt local clock when the frame was received
+   */
+  void receiveFrame(const uint8_t *packet, size_t length, uint64_t receivedAt);
 
+  /**
+   * @brief Send a message in fragments.
+   *
+   * @param data content of the message
+   * @param length length of the message (MBIT_MORE_RADIO_MESSAGE_SIZE at most)
+   */
+  void sendMessage(const uint8_t *data, size_t length);
+
+  /**
+   * @brief Send the rest of fragments of outgoing messages until all of them were sent.
+   */
+  void startFragmenting();
+
+  /**
+   * @brief Send data to a micro:bit and retransmit it until ack is received.
+   * The result is reported to the host on 0x0144.
+   *
+   * @param destination serial number of the destination
+   * @param data content to send
+   * @param length length of the content (MBIT_MORE_RADIO_RELIABLE_DATA_SIZE at most)
+   */
+  void sendReliable(uint32_t destination, const uint8_t *data, size_t length);
+
+  /**
+   * @brief Retransmit frames which were not acknowledged until all of them finish.
+   */
+  void startRetransmitting();
+
+  /**
+   * @brief Set relay of frames from other micro:bits.
+   *
+   * @param on true to relay
+   * @param ttl max hops of frames which are sent from this micro:bit (15 at most)
+   */
+  void setRelay(bool on, uint8_t ttl);
+
+  /**
+   * @brief Send frames waiting to be relayed until all of them were sent.
+   */
+  void startRelaying();
+
+  /**
+   * @brief Send a command to be run on other micro:bits.
+   *
+   * @param destination serial number of the destination or MBIT_MORE_RADIO_COMMAND_BROADCAST
+   * @param options MBIT_MORE_RADIO_COMMAND_REPLY to return the result
+   * @param command command as same as received from the host
+   * @param length length of the command (MBIT_MORE_RADIO_COMMAND_SIZE at most)
+   */
+  void sendCommand(uint32_t destination, uint8_t options, const uint8_t *command, size_t length);
+
+  /**
+   * @brief Set the interval to broadcast telemetry of state and motion.
+   *
+   * @param interval interval [ms] or 0 to stop
+   */
+  void setTelemetry(uint16_t interval);
+
+  /**
+   * @brief Broadcast telemetry periodically until it was stopped.
+   */
+  void startTelemetry();
+
+  /**
+   * @brief Set the role in time synchronization.
+   *
+   * @param role role of this micro:bit
+   * @param interval interval to send beacons as the master [ms]
+   */
+  void setTimeSync(MbitMoreRadioTimeSyncRole role, uint16_t interval);
+
+  /**
+   * @brief Send beacons periodically while this micro:bit is the master.
+   */
+  void startBeacon();
+
+  /**
+   * @brief Return the local clock in the same unit as timestamps of events.
+   *
+   * @return uint64_t local clock [us] on v2 or [ms] on v1
+   */
+  static uint64_t localClock();
+
+  /**
+   * @brief Convert a local timestamp to the clock shared with the master.
+   * The timestamp is returned as is until a beacon is received.
+   *
+   * @param localTime timestamp in the local clock
+   * @return uint64_t timestamp in the shared clock
+   */
+  uint64_t sharedTime(uint64_t localTime);
+
+  /**
+   * @brief Count senders in the node table.
+   *
+   * @return size_t number of senders
+   */
+  size_t nodeCount();
+
+  /**
+   * @brief Make a record of a sender in the node table.
+   * [0] index, [1] count of senders, [2..5] serial, [6..9] elapsed time since last seen [ms],
+   * [10..11] packets, [12..13] lost, [14] EWMA of RSSI, [15] min RSSI, [16] max RSSI
+   * as little-endian. All fields except count are 0 when the index is out of range.
+   *
+   * @param index index of the sender in order of the table
+   * @param record buffer of MBIT_MORE_RADIO_NODE_RECORD_SIZE bytes
+   */
+  void nodeRecord(size_t index, uint8_t *record);
+
+  ~MbitMoreRadio();
 };
 
-#endif
\ No newline at end of file
+#endif // MBIT_MORE_RADIO_H
@@ -0,0 +1,219 @@
+#ifndef MBIT_MORE_RADIO_PACKET_H
+#define MBIT_MORE_RADIO_PACKET_H
+
+#include "pxt.h"
+
+#include "MbitMoreRadio.h"
+
+/**
+ * @brief Size of the common prefix of MakeCode radio packets.
+ * [0] packet type, [1..4] time [ms] and [5..8] serial number of the sender as little-endian.
+ */
+#define MBIT_MORE_RADIO_PACKET_PREFIX_SIZE 9
+#define MBIT_MORE_RADIO_PACKET_TIME_INDEX 1
+#define MBIT_MORE_RADIO_PACKET_SERIAL_INDEX 5
+
+/**
+ * @brief Layout of a frame of Microbit More protocol.
+ * [0] FRAME, [1] kind, [2] flags, [3..6] serial number of the sender and
+ * [7..8] sequence number as little-endian, followed by the payload.
+ */
+#define MBIT_MORE_RADIO_FRAME_KIND_INDEX 1
+#define MBIT_MORE_RADIO_FRAME_FLAGS_INDEX 2
+#define MBIT_MORE_RADIO_FRAME_SERIAL_INDEX 3
+#define MBIT_MORE_RADIO_FRAME_SEQUENCE_INDEX 7
+#define MBIT_MORE_RADIO_FRAME_HEADER_SIZE 9
+#define MBIT_MORE_RADIO_FRAME_PAYLOAD_SIZE (RADIOPACKETSIZE - MBIT_MORE_RADIO_FRAME_HEADER_SIZE)
+
+/**
+ * @brief Flags of a frame.
+ * Low nibble is TTL which is decremented by each relay.
+ */
+#define MBIT_MORE_RADIO_FRAME_TTL_MASK 0x0F
+#define MBIT_MORE_RADIO_FRAME_RELAYED 0x10
+#define MBIT_MORE_RADIO_FRAME_SLEEPY 0x80
+
+/**
+ * @brief Return serial number of the sender of a MakeCode packet or a frame.
+ *
+ * @param packet buffer of the packet
+ * @return uint32_t serial number of the sender
+ */
+inline uint32_t mbitMoreRadioPacketSerial(const uint8_t *packet) {
+  uint32_t serial;
+  if (packet[0] == MbitMoreRadioPacketState::FRAME) {
+    memcpy(&serial, &packet[MBIT_MORE_RADIO_FRAME_SERIAL_INDEX], 4);
+  } else {
+    memcpy(&serial, &packet[MBIT_MORE_RADIO_PACKET_SERIAL_INDEX], 4);
+  }
+  return serial;
+}
+
+/**
+ * @brief Layout of a MakeCode radio packet.
+ * A number of NumberSize bytes follows the prefix,
+ * then a text with its length is placed when MaxTextLength is not 0.
+ *
+ * @tparam Type type of the packet in the first byte
+ * @tparam NumberSize size of the number content [byte]
+ * @tparam MaxTextLength max length of the text content [byte]
+ */
+template <MbitMoreRadioPacketState Type, size_t NumberSize, size_t MaxTextLength>
+struct MbitMoreRadioPacketLayout {
+  static constexpr MbitMoreRadioPacketState type = Type;
+  static constexpr size_t numberIndex = MBIT_MORE_RADIO_PACKET_PREFIX_SIZE;
+  static constexpr size_t numberSize = NumberSize;
+  static constexpr bool hasText = (MaxTextLength > 0);
+  static constexpr size_t textLengthIndex = numberIndex + numberSize;
+  static constexpr size_t textIndex = textLengthIndex + 1;
+  static constexpr size_t maxTextLength = MaxTextLength;
+  static constexpr size_t maxSize = hasText ? (textIndex + maxTextLength) : textLengthIndex;
+
+  static_assert(maxSize <= RADIOPACKETSIZE, "radio packet layout exceeds RADIOPACKETSIZE");
+};
+
+// Layouts which are compatible with the radio blocks of MakeCode.
+typedef MbitMoreRadioPacketLayout<MbitMoreRadioPacketState::NUM, 4, 0> MbitMoreRadioNumberLayout;
+typedef MbitMoreRadioPacketLayout<MbitMoreRadioPacketState::STRING_AND_NUMBER, 4, 12> MbitMoreRadioValueLayout;
+typedef MbitMoreRadioPacketLayout<MbitMoreRadioPacketState::STRING, 0, 19> MbitMoreRadioStringLayout;
+typedef MbitMoreRadioPacketLayout<MbitMoreRadioPacketState::info, 0, 19> MbitMoreRadioBufferLayout;
+typedef MbitMoreRadioPacketLayout<MbitMoreRadioPacketState::DOUBLE, 8, 0> MbitMoreRadioDoubleLayout;
+typedef MbitMoreRadioPacketLayout<MbitMoreRadioPacketState::value, 8, 8> MbitMoreRadioDoubleValueLayout;
+
+/**
+ * @brief Contents of a radio packet which was decoded.
+ * Pointers refer to the buffer of the packet.
+ */
+typedef struct {
+  MbitMoreRadioPacketState type; /** type of the packet */
+  uint32_t time;                 /** running time of the sender [ms] */
+  uint32_t serial;               /** serial number of the sender */
+  const uint8_t *number;         /** number content as little-endian or NULL */
+  size_t numberSize;             /** size of the number content */
+  const uint8_t *text;           /** text content without null termination or NULL */
+  size_t textLength;             /** length of the text content */
+} MbitMoreRadioPacket;
+
+/**
+ * @brief Encoder and decoder for a layout of MakeCode radio packet.
+ *
+ * @tparam Layout MbitMoreRadioPacketLayout of the packet
+ */
+template <class Layout>
+class MbitMoreRadioPacketCodec {
+public:
+  /**
+   * @brief Encode a packet with time and serial number of this micro:bit.
+   * Text longer than the layout allows is truncated.
+   *
+   * @param packet buffer to encode which has RADIOPACKETSIZE bytes at least
+   * @param number number content as little-endian (numberSize bytes)
+   * @param text text content (ignored when the layout has no text)
+   * @param textLength length of the text content
+   * @return size_t length of the encoded packet
+   */
+  static size_t encode(uint8_t *packet, const uint8_t *number, const uint8_t *text, size_t textLength) {
+    packet[0] = Layout::type;
+    uint32_t time = (uint32_t)system_timer_current_time();
+    memcpy(&packet[MBIT_MORE_RADIO_PACKET_TIME_INDEX], &time, 4);
+    uint32_t serial = microbit_serial_number();
+    memcpy(&packet[MBIT_MORE_RADIO_PACKET_SERIAL_INDEX], &serial, 4);
+    if (Layout::numberSize > 0) {
+      memcpy(&packet[Layout::numberIndex], number, Layout::numberSize);
+    }
+    if (!Layout::hasText) {
+      return Layout::textLengthIndex;
+    }
+    size_t length = (textLength < Layout::maxTextLength) ? textLength : Layout::maxTextLength;
+    packet[Layout::textLengthIndex] = (uint8_t)length;
+    memcpy(&packet[Layout::textIndex], text, length);
+    return Layout::textIndex + length;
+  }
+
+  /**
+   * @brief Decode the packet.
+   *
+   * @param packet buffer of the packet
+   * @param length length of the packet
+   * @param decoded contents of the packet
+   * @return true the packet has this layout
+   * @return false the packet is not valid for this layout
+   */
+  static bool decode(const uint8_t *packet, size_t length, MbitMoreRadioPacket *decoded) {
+    if (length < Layout::textLengthIndex || packet[0] != Layout::type) {
+      return false;
+    }
+    decoded->type = Layout::type;
+    memcpy(&decoded->time, &packet[MBIT_MORE_RADIO_PACKET_TIME_INDEX], 4);
+    memcpy(&decoded->serial, &packet[MBIT_MORE_RADIO_PACKET_SERIAL_INDEX], 4);
+    decoded->number = (Layout::numberSize > 0) ? &packet[Layout::numberIndex] : NULL;
+    decoded->numberSize = Layout::numberSize;
+    decoded->text = NULL;
+    decoded->textLength = 0;
+    if (Layout::hasText) {
+      if (length < Layout::textIndex) {
+        return false;
+      }
+      size_t textLength = packet[Layout::textLengthIndex];
+      if (textLength > Layout::maxTextLength || Layout::textIndex + textLength > length) {
+        return false;
+      }
+      decoded->text = &packet[Layout::textIndex];
+      decoded->textLength = textLength;
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief Decode a MakeCode radio packet of any type.
+ *
+ * @param packet buffer of the packet
+ * @param length length of the packet
+ * @param decoded contents of the packet
+ * @return true the packet was decoded
+ * @return false the packet is unknown or broken
+ */
+inline bool decodeMbitMoreRadioPacket(const uint8_t *packet, size_t length, MbitMoreRadioPacket *decoded) {
+  if (length < MBIT_MORE_RADIO_PACKET_PREFIX_SIZE) {
+    return false;
+  }
+  switch (packet[0]) {
+  case MbitMoreRadioPacketState::NUM:
+    return MbitMoreRadioPacketCodec<MbitMoreRadioNumberLayout>::decode(packet, length, decoded);
+  case MbitMoreRadioPacketState::STRING_AND_NUMBER:
+    return MbitMoreRadioPacketCodec<MbitMoreRadioValueLayout>::decode(packet, length, decoded);
+  case MbitMoreRadioPacketState::STRING:
+    return MbitMoreRadioPacketCodec<MbitMoreRadioStringLayout>::decode(packet, length, decoded);
+  case MbitMoreRadioPacketState::info:
+    return MbitMoreRadioPacketCodec<MbitMoreRadioBufferLayout>::decode(packet, length, decoded);
+  case MbitMoreRadioPacketState::DOUBLE:
+    return MbitMoreRadioPacketCodec<MbitMoreRadioDoubleLayout>::decode(packet, length, decoded);
+  case MbitMoreRadioPacketState::value:
+    return MbitMoreRadioPacketCodec<MbitMoreRadioDoubleValueLayout>::decode(packet, length, decoded);
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Return the number content of the decoded packet as float.
+ *
+ * @param decoded contents of the packet
+ * @return float number content or 0 when the packet has no number
+ */
+inline float mbitMoreRadioPacketNumber(const MbitMoreRadioPacket *decoded) {
+  if (decoded->numberSize == 4) {
+    int32_t number;
+    memcpy(&number, decoded->number, 4);
+    return (float)number;
+  }
+  if (decoded->numberSize == 8) {
+    double number;
+    memcpy(&number, decoded->number, 8);
+    return (float)number;
+  }
+  return 0.0;
+}
+
+#endif // MBIT_MORE_RADIO_PACKET_H
@@ -23,14 +23,36 @@ void startMbitMoreSerialUpdating() {
 
 /**
  * @brief Read one byte from RX. Current fiber sleeps until when received a data.
+ * A byte already in the RX buffer is read without sleeping.
  * 
  * @return uint8_t Data read from RX
  */
 uint8_t readSync() {
-  fiber_sleep(1); // Need to prevent from freezing
+  if (uBit.serial.rxBufferedSize() == 0) {
+    fiber_sleep(1); // Need to prevent from freezing
+  }
   return uBit.serial.read(SYNC_SLEEP);
 }
 
+/**
+ * @brief Read bytes from RX. Bytes in the RX buffer are read at once and
+ * current fiber sleeps only while the buffer is empty.
+ * 
+ * @param buffer buffer to store the bytes
+ * @param length number of bytes to read
+ */
+void readBytesSync(uint8_t *buffer, size_t length) {
+  size_t received = 0;
+  while (received < length) {
+    int count = uBit.serial.read(&buffer[received], (int)(length - received), ASYNC);
+    if (count > 0) {
+      received += count;
+      continue;
+    }
+    buffer[received++] = readSync();
+  }
+}
+
 /**
  * @brief Calculate checksum of the data. Sum of the buffer and return the remainder which deviced by 0xFF. 
  * 
@@ -133,7 +155,7 @@ void MbitMoreSerial::startSerialReceiving() {
   uBit.serial.setRxBufferSize(MM_RX_BUFFER_SIZE);
   uBit.serial.clearRxBuffer();
 
-  uint8_t frame[26] = {0};
+  uint8_t frame[5 + MM_SERIAL_COMMAND_SIZE_MAX + 1] = {0};
   size_t frameReceived = 0;
 
   while (true) {
@@ -142,6 +164,8 @@ void MbitMoreSerial::startSerialReceiving() {
       memmove(frame, frame + 1, frameReceived);
     }
     if (frameReceived == 0) {
+      // Let other fibers run between frames because reading buffered bytes does not sleep.
+      schedule();
       frame[0] = readSync();
       if (MM_SFD != frame[0]) {
         continue;
@@ -168,6 +192,8 @@ void MbitMoreSerial::startSerialReceiving() {
     }
     ch = frame[2] << 8;
     ch |= frame[3];
+    // Time of receiving the request is used by the ping.
+    uint64_t receivedAt = system_timer_current_time_us();
     // COMMAND
     if (0x0100 == ch) {
       if (ChRequest::REQ_READ == requestType) {
@@ -189,23 +215,26 @@ void MbitMoreSerial::startSerialReceiving() {
           frameReceived = 5;
         }
         uint8_t commandLength = frame[4];
-        if (commandLength > 20) {
+        if (commandLength > MM_SERIAL_COMMAND_SIZE_MAX) {
           frameReceived--;
           memmove(frame, frame + 1, frameReceived);
           continue;
         }
         size_t frameSize = 5 + commandLength + 1;
-        for (size_t i = frameReceived; i < frameSize; i++) {
-          frame[i] = readSync();
-          frameReceived = i + 1;
-        }
+        readBytesSync(&frame[frameReceived], frameSize - frameReceived);
+        frameReceived = frameSize;
         if (chksum8(frame, 5 + commandLength) != frame[frameSize - 1]) {
           frameReceived--;
           memmove(frame, frame + 1, frameReceived);
           continue;
         }
-        memcpy(moreService->commandChBuffer, &frame[5], commandLength);
-        mbitMore.onCommandReceived(moreService->commandChBuffer, commandLength);
+        if (commandLength <= MM_CH_BUFFER_SIZE_COMMAND) {
+          memcpy(moreService->commandChBuffer, &frame[5], commandLength);
+          mbitMore.onCommandReceived(moreService->commandChBuffer, commandLength);
+        } else {
+          // Long command does not fit in the characteristic buffer.
+          mbitMore.onCommandReceived(&frame[5], commandLength);
+        }
         if (ChRequest::REQ_WRITE_RESPONSE == requestType) {
           writeResponseOnSerial(ch, true);
         }
@@ -264,6 +293,46 @@ void MbitMoreSerial::startSerialReceiving() {
       }
     }
 
+    // RADIO_NODES
+    if (0x0141 == ch) {
+      if (ChRequest::REQ_READ == requestType) {
+        // Dump the node table as a response for each sender.
+        uint8_t record[MBIT_MORE_RADIO_NODE_RECORD_SIZE];
+        MbitMoreRadio *radio = mbitMore.radio();
+        size_t count = radio->nodeCount();
+        size_t index = 0;
+        do {
+          radio->nodeRecord(index, record);
+          readResponseOnSerial(ch, record, MBIT_MORE_RADIO_NODE_RECORD_SIZE);
+          index++;
+        } while (index < count);
+        frameReceived = 0; // reset frame reading
+        continue;
+      }
+    }
+
+    // PING
+    if (0x0150 == ch) {
+      if (ChRequest::REQ_READ == requestType) {
+        // Times [us] since boot are read as uint64_t little-endian by the host
+        // to estimate the offset and drift of the clock like NTP.
+        // [16..19] is the count of events dropped since boot as uint32_t little-endian.
+        uint8_t times[20];
+        memcpy(&times[0], &receivedAt, 8);
+        uint32_t dropped = mbitMore.getEventsDropped();
+        memcpy(&times[16], &dropped, 4);
+        // Wait for the TX buffer before taking the time to send it without delay.
+        while ((MM_TX_BUFFER_SIZE - uBit.serial.txBufferedSize()) < (6 + 20)) {
+          fiber_sleep(1);
+        }
+        uint64_t sentAt = system_timer_current_time_us();
+        memcpy(&times[8], &sentAt, 8);
+        readResponseOnSerial(ch, times, 20);
+        frameReceived = 0; // reset frame reading
+        continue;
+      }
+    }
+
     // Not matched
     frameReceived--;
     memmove(frame, frame + 1, frameReceived);
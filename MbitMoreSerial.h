@@ -9,6 +9,7 @@
 #define MM_SFD 0xff
 #define MM_RX_BUFFER_SIZE 254
 #define MM_TX_BUFFER_SIZE 254
+#define MM_SERIAL_COMMAND_SIZE_MAX 130 // longer than BLE to accept radio messages
 
 // // Forward declaration
 class MbitMoreDevice;
@@ -300,5 +300,18 @@ void MbitMoreService::sendTextWithLabel(ManagedString dataLabel, ManagedString d
   mbitMore->sendTextWithLabel(dataLabel, dataContent);
 }
 
+/**
+ * @brief Set whether received radio packets update the labeled data.
+ * The radio is enabled when the bridge is turned on.
+ * 
+ * @param on true to update the labeled data
+ */
+void MbitMoreService::setRadioBridge(bool on) {
+  mbitMore->radioBridge = on;
+  if (on) {
+    mbitMore->radio();
+  }
+}
+
 #endif // CONFIG_ENABLED(DEVICE_BLE)
 #endif // MICROBIT_CODAL
\ No newline at end of file
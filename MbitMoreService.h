@@ -153,6 +153,13 @@ public:
    */
   void sendTextWithLabel(ManagedString dataLabel, ManagedString dataContent);
 
+  /**
+   * @brief Set whether received radio packets update the labeled data.
+   * 
+   * @param on true to update the labeled data
+   */
+  void setRadioBridge(bool on);
+
 private:
   /**
    * @brief micro:bit runtime object.
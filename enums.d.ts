@@ -22,6 +22,7 @@
     CMD_AUDIO = 0x03,
     CMD_DATA = 0x04,
     CMD_RADIO = 0x05,
+    CMD_SEQUENCE = 0x06,
     }
 
 
@@ -32,6 +33,8 @@
     SET_SERVO = 0x03,
     SET_PULL = 0x04,
     SET_EVENT = 0x05,
+    SET_OUTPUTS = 0x06,
+    GET_INPUTS = 0x07,
     }
 
 
@@ -70,6 +73,11 @@
     ACTION_EVENT = 0x12,
     DATA_NUMBER = 0x13,
     DATA_TEXT = 0x14,
+    PIN_EDGES = 0x15,
+    PIN_COUNT = 0x16,
+    PIN_INPUTS = 0x17,
+    PIN_EVENTS = 0x18,
+    ACTION_EVENTS = 0x19,
     }
 
 
@@ -77,6 +85,7 @@
     {
     BUTTON = 0x01,
     GESTURE = 0x02,
+    RULE_DISABLED = 0x03,
     }
 
 
@@ -113,6 +122,8 @@
     ON_EDGE = 1,
     ON_PULSE = 2,
     ON_TOUCH = 3,
+    ON_CAPTURE = 4,
+    ON_COUNT = 5,
     }
 
 
@@ -134,6 +145,60 @@
     {
     MIC = 0x01,
     TOUCH = 0x02,
+    COMPASS_CALIBRATE = 0x03,
+    STATE_PUSH = 0x04,
+    EVENT_MASK = 0x05,
+    TIMESTAMP = 0x06,
+    RULE = 0x07,
+    RADIO_ON_START = 0x08,
+    }
+
+
+    /**
+     * @brief Enum for triggers of event-action rules.
+     * 
+     */
+
+    declare const enum MbitMoreRuleTrigger
+    {
+    RULE_NONE = 0,
+    RULE_PIN = 1,
+    RULE_BUTTON = 2,
+    RULE_GESTURE = 3,
+    RULE_ABOVE = 4,
+    RULE_BELOW = 5,
+    }
+
+
+    /**
+     * @brief Enum for actions of event-action rules.
+     * 
+     */
+
+    declare const enum MbitMoreRuleAction
+    {
+    ACTION_DIGITAL = 1,
+    ACTION_PWM = 2,
+    ACTION_TONE = 3,
+    ACTION_DISPLAY = 4,
+    }
+
+
+    /**
+     * @brief Enum for sources of events which have a mask.
+     * 
+     */
+
+    declare const enum MbitMoreEventMaskSource
+    {
+    MASK_BUTTON_A = 0,
+    MASK_BUTTON_B = 1,
+    MASK_LOGO = 2,
+    MASK_TOUCH_P0 = 3,
+    MASK_TOUCH_P1 = 4,
+    MASK_TOUCH_P2 = 5,
+    MASK_GESTURE = 6,
+    MASK_PIN = 7,
     }
 
 
@@ -149,6 +214,33 @@
     }
 
 
+    /**
+     * @brief Enum for sub-commands about the output sequence.
+     * 
+     */
+
+    declare const enum MbitMoreSequenceCommand
+    {
+    SEQUENCE_CLEAR = 0x00,
+    SEQUENCE_ADD = 0x01,
+    SEQUENCE_PLAY = 0x02,
+    SEQUENCE_STOP = 0x03,
+    }
+
+
+    /**
+     * @brief Enum for actions of a step in the output sequence.
+     * 
+     */
+
+    declare const enum MbitMoreSequenceAction
+    {
+    STEP_DIGITAL = 0x00,
+    STEP_PWM = 0x01,
+    STEP_SERVO = 0x02,
+    }
+
+
     /**
      * @brief Button ID in MicrobitMore
      * This number is used to memory offset in state data.
@@ -237,20 +329,78 @@
     info = 0x03,
     DOUBLE = 0x04,
     value = 0x05,
-
-
+    FRAME = 0x10,
     }
 
 
     declare const enum MbitMoreRadioControlCommand
-    { SETGROUP = 0,
+    {
+    SETGROUP = 0,
     SETSIGNALPOWER = 1,
     SENDSTRING = 2,
     SENDINTNUMBER = 3,
     SENDVALUE = 4,
     SENDDOUBLENUMBER = 5,
     GETLASTPACKETSIGNAL = 6,
+    SETBRIDGE = 7,
+    SETFREQUENCYBAND = 8,
+    SETDATARATE = 9,
+    SETQUEUEDEPTH = 10,
+    SENDMESSAGE = 11,
+    SENDRELIABLE = 12,
+    SETRELAY = 13,
+    REMOTECOMMAND = 14,
+    SETTELEMETRY = 15,
+    SETTIMESYNC = 16,
+    SETADAPTIVEPOWER = 17,
+    SETDUTYCYCLE = 18,
+    }
+
+
+    /**
+     * @brief Kind of the frame of Microbit More protocol.
+     */
+
+    declare const enum MbitMoreRadioFrameKind
+    {
+    FRAGMENT = 0x01,
+    RELIABLE = 0x02,
+    ACK = 0x03,
+    COMMAND = 0x04,
+    RESULT = 0x05,
+    TELEMETRY_STATE = 0x06,
+    TELEMETRY_MOTION = 0x07,
+    BEACON = 0x08,
+    }
 
+
+    /**
+     * @brief Role in time synchronization.
+     */
+
+    declare const enum MbitMoreRadioTimeSyncRole
+    {
+    TIMESYNC_OFF = 0,
+    TIMESYNC_MASTER = 1,
+    TIMESYNC_NODE = 2,
+    }
+
+
+    /**
+     * @brief Result of reliable delivery reported to the host.
+     */
+
+    declare const enum MbitMoreRadioDeliveryStatus
+    {
+    DELIVERY_FAILED = 0,
+    DELIVERED = 1,
+    }
+
+
+    declare const enum MbitMoreRadioDataRate
+    {
+    RADIO_1MBPS = 0,
+    RADIO_2MBPS = 1,
     }
 declare namespace MbitMore {
 }
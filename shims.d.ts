@@ -60,6 +60,15 @@ declare namespace MbitMore {
      */
     //% shim=MbitMore::call_sendTextWithLabel
     function call_sendTextWithLabel(dataLabel: string, dataContent: string): void;
+
+    /**
+     * @brief Set whether received radio packets update the labeled data.
+     * This starts Microbit More service if it was not available.
+     * 
+     * @param on true to update the labeled data
+     */
+    //% shim=MbitMore::call_setRadioBridge
+    function call_setRadioBridge(on: boolean): void;
 }
 
 // Auto-generated. Do not edit. Really.
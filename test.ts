@@ -7,4 +7,5 @@ MbitMore.onReceivedNumberWithLabel("label-01", function (content) {
   MbitMore.sendNumberWithLabel("label-01", content);
   // basic.showString("label-01 = N " + (content))
 })
+MbitMore.setRadioBridge(true)
 MbitMore.startService()
@@ -0,0 +1,32 @@
+// Minimal checks for the host tests of Microbit More.
+#pragma once
+#include <stdio.h>
+
+static int checksFailed = 0;
+static int checksRun = 0;
+
+#define CHECK(cond)                                                      \
+  do {                                                                   \
+    checksRun++;                                                         \
+    if (!(cond)) {                                                       \
+      checksFailed++;                                                    \
+      printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);  \
+    }                                                                    \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                                 \
+  do {                                                                                 \
+    checksRun++;                                                                       \
+    long long checkA = (long long)(a);                                                 \
+    long long checkB = (long long)(b);                                                 \
+    if (checkA != checkB) {                                                            \
+      checksFailed++;                                                                  \
+      printf("%s:%d: CHECK_EQ failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, \
+             #a, #b, checkA, checkB);                                                  \
+    }                                                                                  \
+  } while (0)
+
+static int checkSummary(const char *name) {
+  printf("%s: %d checks, %d failed\n", name, checksRun, checksFailed);
+  return checksFailed == 0 ? 0 : 1;
+}
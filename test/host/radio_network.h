@@ -0,0 +1,105 @@
+// Network of micro:bits on the fake radio.
+// Each node is a MbitMoreRadio with its own serial number, and datagrams on the air
+// are delivered only to the nodes linked with the sender.
+#pragma once
+#include "pxt.h"
+
+#define private public
+#define protected public
+#include "MbitMoreDevice.h"
+#include "MbitMoreRadio.h"
+#include "MbitMoreRadioPacket.h"
+#undef private
+#undef protected
+
+#include <vector>
+
+struct RadioNetwork {
+  MbitMoreDevice &device = MbitMoreDevice::getInstance();
+  std::vector<MbitMoreRadio *> radios;
+  std::vector<uint32_t> serials;
+  std::vector<std::vector<bool>> links;
+  std::vector<fake::Datagram> sent; // all datagrams sent on the air
+
+  int add(uint32_t serial) {
+    fake::serial = serial;
+    radios.push_back(new MbitMoreRadio(device));
+    serials.push_back(serial);
+    for (size_t i = 0; i < links.size(); i++) {
+      links[i].push_back(false);
+    }
+    links.push_back(std::vector<bool>(radios.size(), false));
+    return (int)radios.size() - 1;
+  }
+
+  void link(int a, int b) {
+    links[a][b] = true;
+    links[b][a] = true;
+  }
+
+  // Select the node to run as this micro:bit.
+  MbitMoreRadio *use(int node) {
+    fake::serial = serials[node];
+    device.Radio = radios[node];
+    return radios[node];
+  }
+
+  int nodeOf(uint32_t serial) {
+    for (size_t i = 0; i < serials.size(); i++) {
+      if (serials[i] == serial)
+        return (int)i;
+    }
+    return -1;
+  }
+
+  void deliver(int node, const fake::Datagram &datagram) {
+    use(node);
+    fake::Datagram d = datagram;
+    d.rssi = -60;
+    fake::rxQueue.push_back(d);
+    device.onRadioreceived(MicroBitEvent(MICROBIT_ID_RADIO, MICROBIT_RADIO_EVT_DATAGRAM, CREATE_ONLY));
+  }
+
+  // Deliver datagrams on the air and run relays until the air is quiet.
+  void run() {
+    while (true) {
+      std::vector<fake::Datagram> air;
+      air.swap(fake::air);
+      for (size_t i = 0; i < air.size(); i++) {
+        sent.push_back(air[i]);
+        int sender = nodeOf(air[i].sender);
+        for (size_t node = 0; node < radios.size(); node++) {
+          if (sender >= 0 && links[sender][node]) {
+            deliver(node, air[i]);
+          }
+        }
+      }
+      bool relaying = false;
+      for (size_t node = 0; node < radios.size(); node++) {
+        if (radios[node]->relayRunning) {
+          relaying = true;
+          use(node)->startRelaying();
+        }
+      }
+      if (!relaying && fake::air.empty())
+        return;
+    }
+  }
+
+  // Count datagrams sent by the node which carry the frame of the origin.
+  int countSent(int node, uint32_t origin, uint16_t sequence) {
+    int count = 0;
+    for (size_t i = 0; i < sent.size(); i++) {
+      const fake::Datagram &d = sent[i];
+      if (d.sender != serials[node] || d.bytes[0] != MbitMoreRadioPacketState::FRAME)
+        continue;
+      if (mbitMoreRadioPacketSerial(d.bytes) != origin)
+        continue;
+      uint16_t s;
+      memcpy(&s, &d.bytes[MBIT_MORE_RADIO_FRAME_SEQUENCE_INDEX], 2);
+      if (s == sequence)
+        count++;
+    }
+    return count;
+  }
+};
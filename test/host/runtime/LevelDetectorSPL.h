@@ -0,0 +1,6 @@
+#pragma once
+namespace codal {
+struct LevelDetectorSPL {
+  int getValue() { return 0; }
+};
+} // namespace codal
@@ -0,0 +1,318 @@
+// Fake of the micro:bit runtime to run Microbit More on the host.
+// Only what the sources use is declared, and the radio, serial port and clock
+// are recorded in fake:: to be inspected by the tests.
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#define MICROBIT_EVT_ANY 0
+#define MICROBIT_ID_ANY 0
+#define MICROBIT_ID_BUTTON_A 1
+#define MICROBIT_ID_BUTTON_B 2
+#define MICROBIT_ID_LOGO 121
+#define MICROBIT_ID_GESTURE 27
+#define MICROBIT_ID_RADIO 29
+#define MICROBIT_ID_COMPASS 6
+#define MICROBIT_ID_BLE 1000
+#define MICROBIT_BLE_EVT_CONNECTED 1
+#define MICROBIT_BLE_EVT_DISCONNECTED 2
+#define MICROBIT_RADIO_EVT_DATAGRAM 1
+#define MICROBIT_PIN_EVT_RISE 2
+#define MICROBIT_PIN_EVT_FALL 3
+#define MICROBIT_PIN_EVT_PULSE_HI 4
+#define MICROBIT_PIN_EVT_PULSE_LO 5
+#define MICROBIT_PIN_EVENT_NONE 0
+#define MICROBIT_PIN_EVENT_ON_EDGE 1
+#define MICROBIT_PIN_EVENT_ON_PULSE 2
+#define MICROBIT_PIN_EVENT_ON_TOUCH 3
+#define MICROBIT_BUTTON_EVT_DOWN 1
+#define MICROBIT_BUTTON_EVT_UP 2
+#define MICROBIT_BUTTON_EVT_CLICK 3
+#define MICROBIT_RADIO_MAX_PACKET_SIZE 32
+#define MICROBIT_RADIO_DEFAULT_FREQUENCY 7
+#define MICROBIT_OK 0
+#define MICROBIT_INVALID_PARAMETER -1001
+#define MESSAGE_BUS_LISTENER_QUEUE_IF_BUSY 0x20
+#define MESSAGE_BUS_LISTENER_DROP_IF_BUSY 0x40
+#define MESSAGE_BUS_LISTENER_IMMEDIATE 0x80
+#define SYNC_SLEEP 1
+#define ASYNC 0
+#define CREATE_ONLY 0
+
+namespace fake {
+struct Datagram {
+  uint32_t sender; // serial number of the micro:bit which sent it
+  int rssi;
+  int length;
+  uint8_t bytes[MICROBIT_RADIO_MAX_PACKET_SIZE];
+};
+
+extern uint64_t timeUs;                 // clock of the system timer
+extern uint32_t serial;                 // serial number of the running micro:bit
+extern std::vector<Datagram> air;       // datagrams sent by the radio
+extern std::deque<Datagram> rxQueue;    // datagrams waiting for recv()
+extern std::vector<uint8_t> serialTx;   // bytes sent on the serial port
+extern std::deque<uint8_t> serialRx;    // bytes waiting to be read on the serial port
+extern long heapAllocations;            // count of operator new
+extern long heapFrees;                  // count of operator delete
+extern long runtimeAllocations;         // count of allocations inside the fake runtime
+extern long eventsFired;                // count of events fired
+extern int fibersCreated;
+
+// Allocations of the fake itself are not counted while this is alive.
+struct Uncounted {
+  long allocations = heapAllocations;
+  long frees = heapFrees;
+  ~Uncounted() {
+    heapAllocations = allocations;
+    heapFrees = frees;
+  }
+};
+} // namespace fake
+
+struct MicroBitEvent {
+  uint16_t source;
+  uint16_t value;
+  uint64_t timestamp;
+  MicroBitEvent() : source(0), value(0), timestamp(fake::timeUs) {}
+  MicroBitEvent(int s, int v, int m = 1) : source(s), value(v), timestamp(fake::timeUs) {
+    if (m)
+      fire();
+  }
+  void fire() { fake::eventsFired++; }
+};
+
+class ManagedString {
+public:
+  ManagedString() {}
+  ManagedString(const char *) {}
+  ManagedString(int) {}
+  int length() const { return 0; }
+  const char *toCharArray() const { return ""; }
+};
+
+// Heap-backed like the runtime, which allocates for each datagram.
+class PacketBuffer {
+  uint8_t *data = NULL;
+  int size = 0;
+  int rssi = 0;
+
+public:
+  PacketBuffer() {}
+  PacketBuffer(uint8_t *bytes, int length, int signal = 0) : size(length), rssi(signal) {
+    data = new uint8_t[length];
+    fake::runtimeAllocations++;
+    memcpy(data, bytes, length);
+  }
+  PacketBuffer(const PacketBuffer &) = delete;
+  PacketBuffer(PacketBuffer &&other) : data(other.data), size(other.size), rssi(other.rssi) { other.data = NULL; }
+  ~PacketBuffer() {
+    if (data != NULL)
+      delete[] data;
+  }
+  int length() { return size; }
+  uint8_t *getBytes() { return data; }
+  int getRSSI() { return rssi; }
+};
+
+enum class PullMode { None, Up, Down };
+enum PinMode { PullNone, PullUp, PullDown };
+namespace codal {
+enum class TouchMode { Resistive, Capacitative };
+}
+
+struct MicroBitPin {
+  int name = 0;
+  int mode = 0; // 0 none, 1 digital in, 2 digital out, 3 analog in, 4 analog out
+  int value = 0;
+  int isDigital() { return mode == 1 || mode == 2; }
+  int isAnalog() { return mode == 3 || mode == 4; }
+  int isInput() { return mode == 1 || mode == 3; }
+  int isOutput() { return mode == 2 || mode == 4; }
+  int getDigitalValue() { mode = 1; return value ? 1 : 0; }
+  int setDigitalValue(int v) { mode = 2; value = v; return 0; }
+  int setAnalogValue(int v) { mode = 4; value = v; return 0; }
+  int setAnalogPeriodUs(int) { return 0; }
+  int getAnalogValue() { mode = 3; return value; }
+  int setServoValue(int v, int = 2000, int = 1500) { mode = 4; value = v; return 0; }
+  int setPull(PullMode) { return 0; }
+  int setPull(PinMode) { return 0; }
+  int eventOn(int) { return 0; }
+  int isTouched() { return 0; }
+  int isTouched(codal::TouchMode) { return 0; }
+};
+struct MicroBitIO {
+  MicroBitPin pin[21];
+  MicroBitPin speaker;
+};
+struct MicroBitButton {
+  int isPressed() { return 0; }
+};
+struct CompassCalibration {
+  int centre[3];
+  int scale[3];
+  int radius;
+};
+struct MicroBitCompass {
+  int isCalibrated() { return 1; }
+  int calibrate() { return 0; }
+  void clearCalibration() {}
+  int heading() { return 0; }
+  int getX() { return 0; }
+  int getY() { return 0; }
+  int getZ() { return 0; }
+  CompassCalibration getCalibration() { return CompassCalibration(); }
+  int setCalibration(CompassCalibration) { return 0; }
+};
+struct MicroBitAccelerometer {
+  float getPitchRadians() { return 0; }
+  float getRollRadians() { return 0; }
+  int getX() { return 0; }
+  int getY() { return 0; }
+  int getZ() { return 0; }
+};
+struct MicroBitDisplayImage {
+  int setPixelValue(int, int, int) { return 0; }
+};
+struct MicroBitDisplay {
+  MicroBitDisplayImage image;
+  void stopAnimation() {}
+  void scrollAsync(ManagedString, int = 120) {}
+  void scrollAsync(int, int = 120) {}
+  void print(const char *) {}
+  int readLightLevel() { return 0; }
+};
+struct MicroBitThermometer {
+  int getTemperature() { return 20; }
+};
+struct MicroBitSerial {
+  int setBaud(int) { return 0; }
+  int baud(int) { return 0; }
+  int read(int) {
+    fake::Uncounted uncounted;
+    if (fake::serialRx.empty())
+      return -1;
+    uint8_t c = fake::serialRx.front();
+    fake::serialRx.pop_front();
+    return c;
+  }
+  int read(uint8_t *buffer, int length, int) {
+    fake::Uncounted uncounted;
+    int count = 0;
+    while (count < length && !fake::serialRx.empty()) {
+      buffer[count++] = fake::serialRx.front();
+      fake::serialRx.pop_front();
+    }
+    return count;
+  }
+  int rxBufferedSize() { return (int)fake::serialRx.size(); }
+  int send(uint8_t *bytes, int length, int) {
+    fake::Uncounted uncounted;
+    fake::serialTx.insert(fake::serialTx.end(), bytes, bytes + length);
+    return length;
+  }
+  int txBufferedSize() { return 0; }
+  int setTxBufferSize(int) { return 0; }
+  int setRxBufferSize(int) { return 0; }
+  void clearTxBuffer() {}
+  void clearRxBuffer() {}
+};
+struct MicroBitRadioDatagram {
+  int send(uint8_t *bytes, int length) {
+    fake::Uncounted uncounted;
+    fake::Datagram d;
+    d.sender = fake::serial;
+    d.rssi = -50;
+    d.length = length;
+    memcpy(d.bytes, bytes, length);
+    fake::air.push_back(d);
+    return 0;
+  }
+  int recv(uint8_t *bytes, int length) {
+    fake::Uncounted uncounted;
+    if (fake::rxQueue.empty())
+      return -1;
+    fake::Datagram d = fake::rxQueue.front();
+    fake::rxQueue.pop_front();
+    int n = (d.length < length) ? d.length : length;
+    memcpy(bytes, d.bytes, n);
+    return n;
+  }
+  PacketBuffer recv() {
+    fake::Datagram d;
+    {
+      fake::Uncounted uncounted;
+      if (fake::rxQueue.empty())
+        return PacketBuffer();
+      d = fake::rxQueue.front();
+      fake::rxQueue.pop_front();
+    }
+    return PacketBuffer(d.bytes, d.length, d.rssi);
+  }
+};
+struct MicroBitRadio {
+  MicroBitRadioDatagram datagram;
+  int enable() { return 0; }
+  int disable() { return 0; }
+  int setGroup(uint8_t) { return 0; }
+  int setTransmitPower(int) { return 0; }
+  int setFrequencyBand(int) { return 0; }
+  int getRSSI() { return -50; }
+};
+struct MicroBitMessageBus {
+  template <class T>
+  int listen(int, int, T *, void (T::*)(MicroBitEvent), uint16_t = 0) { return 0; }
+  template <class T>
+  int ignore(int, int, T *, void (T::*)(MicroBitEvent)) { return 0; }
+};
+struct KeyValuePair {
+  uint8_t key[16];
+  uint8_t value[32];
+};
+struct MicroBitStorage {
+  int put(const char *, uint8_t *, int) { return 0; }
+  KeyValuePair *get(const char *) { return NULL; }
+  int remove(const char *) { return 0; }
+};
+struct MicroBit {
+  MicroBitIO io;
+  MicroBitButton buttonA, buttonB, logo;
+  MicroBitCompass compass;
+  MicroBitAccelerometer accelerometer;
+  MicroBitDisplay display;
+  MicroBitThermometer thermometer;
+  MicroBitSerial serial;
+  MicroBitRadio radio;
+  MicroBitMessageBus messageBus;
+  MicroBitStorage storage;
+  void reset() {}
+};
+
+// Fibers are not run. Sleeping advances the clock.
+inline void fiber_sleep(unsigned long ms) { fake::timeUs += (uint64_t)ms * 1000; }
+inline int fiber_wake_on_event(uint16_t, uint16_t) { return 0; }
+inline void schedule() { fake::timeUs += 1; }
+inline void create_fiber(void (*)()) { fake::fibersCreated++; }
+inline void create_fiber(void (*)(void *), void *) { fake::fibersCreated++; }
+struct MicroBitComponent {
+  virtual void idleCallback() {}
+};
+inline void fiber_add_idle_component(MicroBitComponent *) {}
+inline uint64_t system_timer_current_time() { return fake::timeUs / 1000; }
+// Time passes while it is read in a loop.
+inline uint64_t system_timer_current_time_us() { return fake::timeUs++; }
+inline int system_timer_event_after_us(uint64_t, uint16_t, uint16_t) { return 0; }
+inline int system_timer_cancel_event(uint16_t, uint16_t) { return 0; }
+inline uint32_t microbit_serial_number() { return fake::serial; }
+int microbit_random(int max);
+inline void target_disable_irq() {}
+inline void target_enable_irq() {}
+inline void __disable_irq() {}
+inline void __enable_irq() {}
+struct GattReadAuthCallbackParams {};
+struct GattWriteCallbackParams {};
+struct GattCharacteristic {};
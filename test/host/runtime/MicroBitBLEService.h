@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+struct microbit_ble_evt_t {};
+struct microbit_ble_evt_write_t {
+  uint16_t handle;
+  const uint8_t *data;
+  int len;
+};
+struct microbit_onDataRead_t {
+  uint16_t handle;
+  uint8_t *data;
+  int length;
+};
+struct MicroBitBLEChar {};
+enum {
+  BLE_UUID_TYPE_UNKNOWN,
+  microbit_propWRITE = 1,
+  microbit_propWRITE_WITHOUT = 2,
+  microbit_propREAD = 4,
+  microbit_propNOTIFY = 8,
+  microbit_propREADAUTH = 16
+};
+class MicroBitBLEService {
+public:
+  int bs_uuid_type = 0;
+  virtual ~MicroBitBLEService() {}
+  void RegisterBaseUUID(const uint8_t *) {}
+  void CreateService(uint16_t) {}
+  void CreateCharacteristic(int, uint16_t, uint8_t *, int, int, int) {}
+  uint16_t valueHandle(int) { return 0; }
+  bool getConnected() { return false; }
+  void notifyChrValue(int, uint8_t *, int) {}
+  virtual int characteristicCount() = 0;
+  virtual MicroBitBLEChar *characteristicPtr(int) = 0;
+};
@@ -0,0 +1,80 @@
+// State of the fake runtime and counting of heap allocations.
+#include <new>
+
+#include "pxt.h"
+#include "nrf.h"
+
+namespace fake {
+uint64_t timeUs = 1000000;
+uint32_t serial = 0x1001;
+std::vector<Datagram> air;
+std::deque<Datagram> rxQueue;
+std::vector<uint8_t> serialTx;
+std::deque<uint8_t> serialRx;
+long heapAllocations = 0;
+long heapFrees = 0;
+long runtimeAllocations = 0;
+long eventsFired = 0;
+int fibersCreated = 0;
+} // namespace fake
+
+namespace pxt {
+MicroBit uBit;
+}
+
+static NRF_RADIO_Type radioRegisters;
+static NRF_GPIO_Type gpio0Registers;
+static NRF_GPIO_Type gpio1Registers;
+NRF_RADIO_Type *NRF_RADIO = &radioRegisters;
+NRF_GPIO_Type *NRF_GPIO = &gpio0Registers;
+NRF_GPIO_Type *NRF_P0 = &gpio0Registers;
+NRF_GPIO_Type *NRF_P1 = &gpio1Registers;
+
+static uint32_t randomState = 12345;
+
+int microbit_random(int max) {
+  if (max <= 0)
+    return 0;
+  randomState = randomState * 1103515245 + 12345;
+  return (int)((randomState >> 8) % (uint32_t)max);
+}
+
+void *operator new(size_t size) {
+  fake::heapAllocations++;
+  void *p = malloc(size ? size : 1);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+  if (p == NULL)
+    return;
+  fake::heapFrees++;
+  free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  operator delete(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  operator delete(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+  operator delete(p);
+}
+
+#include "LevelDetectorSPL.h"
+
+namespace pxt {
+codal::LevelDetectorSPL *getMicrophoneLevel() {
+  static codal::LevelDetectorSPL level;
+  return &level;
+}
+} // namespace pxt
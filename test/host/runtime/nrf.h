@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+struct NRF_RADIO_Type {
+  volatile uint32_t MODE, EVENTS_DISABLED, TASKS_DISABLE, EVENTS_READY, TASKS_RXEN, EVENTS_END, TASKS_START, FREQUENCY;
+};
+extern NRF_RADIO_Type *NRF_RADIO;
+struct NRF_GPIO_Type {
+  volatile uint32_t OUT, OUTSET, OUTCLR, IN, DIR;
+};
+extern NRF_GPIO_Type *NRF_GPIO;
+extern NRF_GPIO_Type *NRF_P0;
+extern NRF_GPIO_Type *NRF_P1;
+#define RADIO_MODE_MODE_Nrf_1Mbit 0
+#define RADIO_MODE_MODE_Nrf_2Mbit 1
@@ -0,0 +1,30 @@
+// Fake of pxt.h to build Microbit More on the host as micro:bit v2.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef MICROBIT_CODAL
+#define MICROBIT_CODAL 1
+#endif
+#define CONFIG_ENABLED(x) (x == 1)
+#define DEVICE_BLE 1
+#include "MicroBit.h"
+typedef int TValue;
+struct StringData {
+  const char *data;
+  int length;
+};
+typedef StringData *String;
+#define MSTR(s) ManagedString((s)->data)
+#define PSTR(s) ((String)0)
+namespace pxt {
+extern MicroBit uBit;
+}
+using pxt::uBit;
+template <class T>
+T max(T a, T b) { return a > b ? a : b; }
+template <class T>
+T min(T a, T b) { return a < b ? a : b; }
+inline float max(float a, int b) { return a > b ? a : b; }
+inline float min(int a, float b) { return a < b ? a : b; }
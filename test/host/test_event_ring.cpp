@@ -0,0 +1,143 @@
+// Bursts of events from interrupts are sent in batches without losing any event,
+// or counted exactly as dropped when the ring is full.
+#include "pxt.h"
+
+#define private public
+#define protected public
+#include "MbitMoreDevice.h"
+#include "MbitMoreService.h"
+#undef private
+#undef protected
+
+#include <vector>
+
+#include "check.h"
+
+// Format of notifications is at the end of the data.
+#define MBIT_MORE_DATA_FORMAT_INDEX 19
+
+struct Sent {
+  int kind; // MbitMoreEventKind
+  int source;
+  int value;
+  uint32_t time;
+};
+
+static uint32_t decodeInterval(const uint8_t *data, size_t &offset) {
+  uint32_t interval = 0;
+  int shift = 0;
+  while (true) {
+    uint8_t b = data[offset++];
+    interval |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80))
+      return interval;
+    shift += 7;
+  }
+}
+
+// Decode notifications on the serial into events.
+static std::vector<Sent> decodeSerial() {
+  std::vector<Sent> sent;
+  std::vector<uint8_t> &tx = fake::serialTx;
+  size_t i = 0;
+  while (i + 5 <= tx.size()) {
+    uint16_t ch = (tx[i + 2] << 8) | tx[i + 3];
+    size_t length = tx[i + 4];
+    const uint8_t *data = &tx[i + 5];
+    i += 6 + length;
+    int format = data[MBIT_MORE_DATA_FORMAT_INDEX];
+    if (ch == 0x0110 && format == MbitMoreDataFormat::PIN_EVENT) {
+      uint32_t time;
+      memcpy(&time, &data[2], 4);
+      sent.push_back({MbitMoreEventKind::EVENT_PIN, data[0], data[1], time});
+    } else if (ch == 0x0111 && format == MbitMoreDataFormat::ACTION_EVENT && data[0] == MbitMoreActionEvent::BUTTON) {
+      uint32_t time;
+      memcpy(&time, &data[4], 4);
+      sent.push_back({MbitMoreEventKind::EVENT_BUTTON, data[1], data[3], time});
+    } else if (format == MbitMoreDataFormat::PIN_EVENTS || format == MbitMoreDataFormat::ACTION_EVENTS) {
+      bool pin = (format == MbitMoreDataFormat::PIN_EVENTS);
+      CHECK_EQ(ch, pin ? 0x0110 : 0x0111);
+      int count = data[0];
+      uint32_t time;
+      memcpy(&time, &data[1], 4);
+      size_t offset = 5;
+      for (int n = 0; n < count; n++) {
+        // Events after the first have the interval after the event ID.
+        Sent evt;
+        if (pin) {
+          evt = {MbitMoreEventKind::EVENT_PIN, data[offset], data[offset + 1], time};
+          offset += 2;
+        } else {
+          evt = {MbitMoreEventKind::EVENT_BUTTON, data[offset + 1], data[offset + 2], time};
+          offset += 3;
+        }
+        if (n > 0) {
+          time += decodeInterval(data, offset);
+          evt.time = time;
+        }
+        CHECK(offset <= MBIT_MORE_DATA_FORMAT_INDEX);
+        sent.push_back(evt);
+      }
+    }
+  }
+  return sent;
+}
+
+int main() {
+  MbitMoreDevice &device = MbitMoreDevice::getInstance();
+  // Single events are written in the buffers of the service.
+  new MbitMoreService();
+  device.serialConnected = true;
+
+  std::vector<Sent> expected;
+  long attempted = 0;
+  uint32_t droppedBefore = device.getEventsDropped();
+  int counter = 0;
+  // Bursts of 1 to 60 events are put by interrupts while the fiber drains the ring
+  // only after every few bursts.
+  for (int burst = 0; burst < 200; burst++) {
+    int size = 1 + microbit_random(60);
+    for (int n = 0; n < size; n++) {
+      fake::timeUs += 1 + microbit_random(3000);
+      bool pin = (microbit_random(4) != 0);
+      MicroBitEvent evt;
+      evt.source = pin ? (100 + microbit_random(3)) : MICROBIT_ID_BUTTON_A;
+      evt.value = (uint8_t)(counter++);
+      evt.timestamp = fake::timeUs;
+      bool fits = (device.eventRingHead - device.eventRingTail) < MBIT_MORE_EVENT_RING_SIZE;
+      device.enqueueEvent(pin ? MbitMoreEventKind::EVENT_PIN : MbitMoreEventKind::EVENT_BUTTON, evt);
+      attempted++;
+      if (fits) {
+        expected.push_back({pin ? MbitMoreEventKind::EVENT_PIN : MbitMoreEventKind::EVENT_BUTTON,
+                            pin ? evt.source - 100 : evt.source, evt.value, (uint32_t)evt.timestamp});
+      }
+    }
+    if (microbit_random(3) == 0) {
+      device.sendEvents();
+      CHECK(device.eventRingTail == device.eventRingHead);
+    }
+  }
+  device.sendEvents();
+
+  std::vector<Sent> sent = decodeSerial();
+  long dropped = device.getEventsDropped() - droppedBefore;
+  // Every event was sent or counted as dropped.
+  CHECK_EQ((long)sent.size() + dropped, attempted);
+  CHECK(dropped > 0);
+  // Events were sent in the order and time they were put.
+  CHECK_EQ(sent.size(), expected.size());
+  size_t mismatch = 0;
+  for (size_t i = 0; i < sent.size() && i < expected.size(); i++) {
+    if (sent[i].kind != expected[i].kind || sent[i].source != expected[i].source ||
+        sent[i].value != expected[i].value || sent[i].time != expected[i].time)
+      mismatch++;
+  }
+  CHECK_EQ(mismatch, 0);
+  // Batches need fewer frames than events.
+  size_t frames = 0;
+  for (size_t i = 0; i + 5 <= fake::serialTx.size(); i += 6 + fake::serialTx[i + 4])
+    frames++;
+  CHECK(frames * 2 < sent.size());
+
+  return checkSummary("test_event_ring");
+}
@@ -0,0 +1,46 @@
+// Reading pins at once keeps outputs driven, and pin commands ignore pins out of GPIO.
+#include "pxt.h"
+#include "nrf.h"
+
+#define private public
+#define protected public
+#include "MbitMoreDevice.h"
+#undef private
+#undef protected
+
+#include "check.h"
+
+int main() {
+  MbitMoreDevice &device = MbitMoreDevice::getInstance();
+  MicroBit &uBit = pxt::uBit;
+  for (int i = 0; i < 21; i++) {
+    uBit.io.pin[i].name = i;
+  }
+
+  // P0 is a digital output, P1 a PWM output and P2 an input.
+  device.setDigitalValue(0, 1);
+  device.setAnalogValue(1, 512);
+  NRF_P0->OUT = (1 << 0);
+  NRF_P0->IN = (1 << 2);
+  uint32_t mask = (1 << 0) | (1 << 1) | (1 << 2) | (1 << 3);
+  uint32_t values = device.getDigitalValues(mask);
+  CHECK_EQ(uBit.io.pin[0].mode, 2);
+  CHECK_EQ(uBit.io.pin[1].mode, 4);
+  CHECK_EQ(uBit.io.pin[2].mode, 1);
+  // PWM and pins out of GPIO are not read.
+  CHECK_EQ(mask, (1 << 0) | (1 << 2));
+  CHECK_EQ(values, (1 << 0) | (1 << 2));
+
+  // Pin commands out of GPIO do nothing.
+  uBit.io.pin[3].mode = 0;
+  uint8_t setOutput[] = {(uint8_t)((MbitMoreCommand::CMD_PIN << 5) | MbitMorePinCommand::SET_OUTPUT), 3, 1};
+  device.onCommandReceived(setOutput, sizeof(setOutput));
+  CHECK_EQ(uBit.io.pin[3].mode, 0);
+  uint8_t setPwm[] = {(uint8_t)((MbitMoreCommand::CMD_PIN << 5) | MbitMorePinCommand::SET_PWM), 200, 0, 2};
+  device.onCommandReceived(setPwm, sizeof(setPwm));
+  uint32_t inputs = device.eventInputs;
+  device.releasePinInput(40);
+  CHECK_EQ(device.eventInputs, inputs);
+
+  return checkSummary("test_pin_inputs");
+}
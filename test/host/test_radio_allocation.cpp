@@ -0,0 +1,74 @@
+// Radio packets are sent from the pool without heap allocation,
+// and receiving keeps no heap memory beyond the PacketBuffer of the runtime.
+#include "pxt.h"
+
+#define private public
+#define protected public
+#include "MbitMoreDevice.h"
+#include "MbitMoreRadio.h"
+#include "MbitMoreRadioPacket.h"
+#undef private
+#undef protected
+
+#include "check.h"
+
+static void receive(uint32_t sender, int rssi, const uint8_t *bytes, int length) {
+  fake::Uncounted uncounted;
+  fake::Datagram d;
+  d.sender = sender;
+  d.rssi = rssi;
+  d.length = length;
+  memset(d.bytes, 0, sizeof(d.bytes));
+  memcpy(d.bytes, bytes, length);
+  fake::rxQueue.push_back(d);
+}
+
+int main() {
+  MbitMoreDevice &device = MbitMoreDevice::getInstance();
+  device.serialConnected = true;
+  MbitMoreRadio *radio = device.radio();
+
+  // Sending strings, messages and reliable frames.
+  long allocations = fake::heapAllocations;
+  uint8_t text[] = "hello";
+  uint8_t message[60];
+  memset(message, 'm', sizeof(message));
+  for (int i = 0; i < 100; i++) {
+    radio->sendString(text, 5);
+    radio->sendMessage(message, sizeof(message));
+    // Fibers are not run, then the rest of fragments are sent here.
+    radio->startFragmenting();
+  }
+  CHECK_EQ(fake::heapAllocations - allocations, 0);
+  CHECK(fake::air.size() > 100);
+
+  // Receiving plain datagrams and frames which are forwarded to the host.
+  uint8_t plain[RADIOPACKETSIZE] = {MbitMoreRadioPacketState::STRING, 0, 0, 0, 0, 0, 0, 0, 0, 'a', 'b'};
+  uint8_t frame[RADIOPACKETSIZE];
+  fake::serial = 0x2002;
+  radio->encodeFrameHeader(frame, MbitMoreRadioFrameKind::FRAGMENT, 0);
+  uint8_t fragment[] = {1, 0, 1, 3, 'x', 'y', 'z'};
+  memcpy(&frame[MBIT_MORE_RADIO_FRAME_HEADER_SIZE], fragment, sizeof(fragment));
+  fake::serial = 0x1001;
+  // The first datagram of a sender adds the node table entry, which is not on the heap.
+  allocations = fake::heapAllocations;
+  long frees = fake::heapFrees;
+  long runtimeAllocations = fake::runtimeAllocations;
+  for (int i = 0; i < 200; i++) {
+    receive(0x3003, -40 - (i % 20), plain, 11);
+    memcpy(&frame[MBIT_MORE_RADIO_FRAME_SEQUENCE_INDEX], &i, 2);
+    receive(0x2002, -60, frame, MBIT_MORE_RADIO_FRAME_HEADER_SIZE + sizeof(fragment));
+    device.onRadioreceived(MicroBitEvent(MICROBIT_ID_RADIO, MICROBIT_RADIO_EVT_DATAGRAM, CREATE_ONLY));
+  }
+  long received = fake::runtimeAllocations - runtimeAllocations;
+  CHECK_EQ(received, 400);
+  // Only the runtime allocated, and all of them were released.
+  CHECK_EQ(fake::heapAllocations - allocations, received);
+  CHECK_EQ(fake::heapFrees - frees, received);
+  // RSSI is of each datagram, not of the last one.
+  CHECK_EQ(radio->lastPacketSignal(), -60);
+  CHECK(fake::rxQueue.empty());
+  CHECK(!fake::serialTx.empty());
+
+  return checkSummary("test_radio_allocation");
+}
@@ -0,0 +1,73 @@
+// Long messages return to the serial fiber after the first fragment and the rest
+// are paced by another fiber. Serial commands are read without sleeping per byte.
+#include "pxt.h"
+
+#define private public
+#define protected public
+#include "MbitMoreDevice.h"
+#include "MbitMoreRadio.h"
+#include "MbitMoreRadioPacket.h"
+#undef private
+#undef protected
+
+#include "check.h"
+
+uint8_t readSync();
+void readBytesSync(uint8_t *buffer, size_t length);
+
+int main() {
+  MbitMoreDevice &device = MbitMoreDevice::getInstance();
+  MbitMoreRadio *radio = device.radio();
+
+  // A message of 7 fragments sends only the first one in the caller.
+  uint8_t message[MBIT_MORE_RADIO_MESSAGE_SIZE];
+  for (size_t i = 0; i < sizeof(message); i++) {
+    message[i] = (uint8_t)i;
+  }
+  fake::air.clear();
+  uint64_t startedAt = fake::timeUs;
+  int fibers = fake::fibersCreated;
+  radio->sendMessage(message, sizeof(message));
+  CHECK(fake::timeUs - startedAt < 1000);
+  CHECK_EQ(fake::air.size(), 1);
+  CHECK_EQ(fake::fibersCreated - fibers, 1);
+
+  // Another message waits in the ring behind it.
+  radio->sendMessage(message, 40);
+  CHECK_EQ(fake::air.size(), 1);
+  CHECK_EQ(radio->outgoingHead - radio->outgoingTail, 2);
+
+  // The fiber paces the rest in order.
+  radio->startFragmenting();
+  CHECK_EQ(fake::air.size(), 7 + 3);
+  CHECK(!radio->fragmentingRunning);
+  for (size_t i = 0; i < fake::air.size(); i++) {
+    const uint8_t *payload = &fake::air[i].bytes[MBIT_MORE_RADIO_FRAME_HEADER_SIZE];
+    int index = (i < 7) ? i : (i - 7);
+    CHECK_EQ(payload[1], index);
+    CHECK_EQ(payload[2], (i < 7) ? 7 : 3);
+  }
+  CHECK(fake::timeUs - startedAt >= 9 * MBIT_MORE_RADIO_FRAGMENT_INTERVAL * 1000);
+
+  // A message in a fragment is sent at once.
+  fake::air.clear();
+  fibers = fake::fibersCreated;
+  radio->sendMessage(message, 10);
+  CHECK_EQ(fake::air.size(), 1);
+  CHECK_EQ(fake::fibersCreated - fibers, 0);
+
+  // A command in the RX buffer is read without sleeping for each byte.
+  for (int i = 0; i < 130; i++) {
+    fake::serialRx.push_back((uint8_t)i);
+  }
+  startedAt = fake::timeUs;
+  uint8_t first = readSync();
+  uint8_t rest[129];
+  readBytesSync(rest, sizeof(rest));
+  CHECK_EQ(first, 0);
+  CHECK_EQ(rest[128], 129);
+  CHECK(fake::serialRx.empty());
+  CHECK(fake::timeUs - startedAt < 1000);
+
+  return checkSummary("test_radio_message");
+}
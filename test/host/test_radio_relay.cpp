@@ -0,0 +1,78 @@
+// Frames are relayed over hops in the length as received, each node relays a frame
+// at most once even in a loop, and the destination does not relay frames to it.
+#include "radio_network.h"
+
+#include "check.h"
+
+int main() {
+  RadioNetwork net;
+
+  // Line of 0 - 1 - 2 - 3 - 4 where all nodes relay.
+  for (int i = 0; i < 5; i++) {
+    net.add(0x1000 + i);
+    if (i > 0)
+      net.link(i - 1, i);
+  }
+  for (int i = 0; i < 5; i++) {
+    net.use(i)->setRelay(true, 4);
+  }
+
+  // A short message from 0 reaches 4 through all hops.
+  uint16_t sequence = net.radios[0]->frameSequence;
+  uint8_t text[] = "hi";
+  net.use(0)->sendMessage(text, 2);
+  size_t length = fake::air.back().length;
+  CHECK(length < RADIOPACKETSIZE);
+  net.run();
+  for (int i = 0; i < 5; i++) {
+    CHECK_EQ(net.countSent(i, net.serials[0], sequence), 1);
+  }
+  // Relayed frames keep the length as received.
+  for (size_t i = 0; i < net.sent.size(); i++) {
+    CHECK_EQ(net.sent[i].length, length);
+  }
+  // TTL is decreased on each hop.
+  for (size_t i = 0; i < net.sent.size(); i++) {
+    int node = net.nodeOf(net.sent[i].sender);
+    CHECK_EQ(net.sent[i].bytes[MBIT_MORE_RADIO_FRAME_FLAGS_INDEX] & MBIT_MORE_RADIO_FRAME_TTL_MASK, 4 - node);
+  }
+
+  // A reliable frame to 2 is not relayed by 2, and the ack comes back through 1.
+  net.sent.clear();
+  sequence = net.radios[0]->frameSequence;
+  uint8_t data[] = {1, 2, 3};
+  net.use(0)->sendReliable(net.serials[2], data, sizeof(data));
+  net.run();
+  CHECK_EQ(net.countSent(1, net.serials[0], sequence), 1);
+  CHECK_EQ(net.countSent(2, net.serials[0], sequence), 0);
+  CHECK_EQ(net.countSent(3, net.serials[0], sequence), 0);
+  for (int i = 0; i < MBIT_MORE_RADIO_RELIABLE_SLOTS; i++) {
+    CHECK_EQ(net.radios[0]->pendingFrames[i].destination, 0);
+  }
+
+  // Loop of 6 nodes with chords: every node gets the frame and sends it once.
+  RadioNetwork loop;
+  for (int i = 0; i < 6; i++) {
+    loop.add(0x2000 + i);
+  }
+  for (int i = 0; i < 6; i++) {
+    loop.link(i, (i + 1) % 6);
+    loop.use(i)->setRelay(true, 5);
+  }
+  loop.link(0, 3);
+  loop.link(1, 4);
+  sequence = loop.radios[0]->frameSequence;
+  loop.use(0)->sendMessage(text, 2);
+  loop.run();
+  int transmissions = 0;
+  for (int i = 0; i < 6; i++) {
+    int count = loop.countSent(i, loop.serials[0], sequence);
+    CHECK_EQ(count, 1);
+    transmissions += count;
+  }
+  // Duplicate load is one transmission for each node.
+  CHECK_EQ(transmissions, 6);
+  CHECK_EQ(loop.sent.size(), 6);
+
+  return checkSummary("test_radio_relay");
+}
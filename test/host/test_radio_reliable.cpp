@@ -0,0 +1,120 @@
+// Reliable frames from many senders are passed to the host once across the wrap
+// of sequence numbers, and retransmits are acknowledged again without passing them.
+#include "radio_network.h"
+
+#include <map>
+#include <utility>
+
+#include "check.h"
+
+#define SENDERS 12
+#define ROUNDS 40
+
+// Count reliable data passed to the host for each pair of the sender and the first byte.
+static std::map<std::pair<uint32_t, int>, int> decodeDelivered() {
+  std::map<std::pair<uint32_t, int>, int> delivered;
+  std::vector<uint8_t> &tx = fake::serialTx;
+  size_t i = 0;
+  while (i + 5 <= tx.size()) {
+    uint16_t ch = (tx[i + 2] << 8) | tx[i + 3];
+    size_t length = tx[i + 4];
+    const uint8_t *data = &tx[i + 5];
+    i += 6 + length;
+    if (ch != 0x0143)
+      continue;
+    uint32_t sender;
+    memcpy(&sender, &data[0], 4);
+    delivered[std::make_pair(sender, (int)data[6])]++;
+  }
+  return delivered;
+}
+
+// Retransmit of the frame which has a new frame sequence number as the sender does.
+static fake::Datagram retransmit(const fake::Datagram &datagram) {
+  fake::Datagram d = datagram;
+  d.bytes[MBIT_MORE_RADIO_FRAME_SEQUENCE_INDEX + 1] ^= 0x80;
+  return d;
+}
+
+static int countAcks(const std::vector<fake::Datagram> &sent, uint32_t from) {
+  int count = 0;
+  for (size_t i = 0; i < sent.size(); i++) {
+    if (sent[i].sender == from && sent[i].bytes[1] == MbitMoreRadioFrameKind::ACK)
+      count++;
+  }
+  return count;
+}
+
+int main() {
+  RadioNetwork net;
+  // Star of senders around the receiver 0 without relays.
+  net.add(0x3000);
+  for (int i = 1; i <= SENDERS; i++) {
+    net.add(0x3000 + i);
+    net.link(0, i);
+  }
+  net.device.serialConnected = true;
+  // Each sender counts just before the wrap.
+  for (int i = 1; i <= SENDERS; i++) {
+    net.use(i)->addNode(net.serials[0])->reliableSequence = 0xFFF0 + i;
+  }
+
+  std::vector<std::vector<fake::Datagram>> reliables(ROUNDS);
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 1; i <= SENDERS; i++) {
+      uint8_t data[] = {(uint8_t)round, (uint8_t)i};
+      net.use(i)->sendReliable(net.serials[0], data, sizeof(data));
+      for (size_t n = 0; n < fake::air.size(); n++) {
+        if (fake::air[n].bytes[1] == MbitMoreRadioFrameKind::RELIABLE)
+          reliables[round].push_back(fake::air[n]);
+      }
+      net.run();
+    }
+    CHECK_EQ(reliables[round].size(), SENDERS);
+
+    // Retransmits of this round and of an older round are acknowledged but not passed.
+    if (round % 8 == 7) {
+      net.sent.clear();
+      const std::vector<fake::Datagram> &older = reliables[round - 5];
+      for (int i = 0; i < SENDERS; i++) {
+        net.deliver(0, retransmit(reliables[round][i]));
+        net.deliver(0, retransmit(older[i]));
+      }
+      net.run();
+      CHECK_EQ(countAcks(net.sent, net.serials[0]), 2 * SENDERS);
+    }
+  }
+
+  // All frames were acknowledged and passed to the host once.
+  for (int i = 1; i <= SENDERS; i++) {
+    for (int n = 0; n < MBIT_MORE_RADIO_RELIABLE_SLOTS; n++) {
+      CHECK_EQ(net.radios[i]->pendingFrames[n].destination, 0);
+    }
+    CHECK_EQ(net.radios[i]->lookupNode(net.serials[0])->reliableSequence, (uint16_t)(0xFFF0 + i + ROUNDS));
+  }
+  std::map<std::pair<uint32_t, int>, int> delivered = decodeDelivered();
+  int wrong = 0;
+  for (int i = 1; i <= SENDERS; i++) {
+    for (int round = 0; round < ROUNDS; round++) {
+      if (delivered[std::make_pair(net.serials[i], round)] != 1)
+        wrong++;
+    }
+  }
+  CHECK_EQ(wrong, 0);
+  CHECK_EQ(delivered.size(), SENDERS * ROUNDS);
+
+  // A restarted sender counts from another number and is passed to the host.
+  fake::serialTx.clear();
+  net.use(1)->addNode(net.serials[0])->reliableSequence -= 1000;
+  uint8_t data[] = {0xAA, 1};
+  net.use(1)->sendReliable(net.serials[0], data, sizeof(data));
+  net.run();
+  CHECK_EQ((decodeDelivered()[std::make_pair(net.serials[1], 0xAA)]), 1);
+
+  // Delivery is reported with the sequence number of 16 bits.
+  uint16_t reported;
+  memcpy(&reported, &fake::serialTx[fake::serialTx.size() - 1 - 8 + 4], 2);
+  CHECK_EQ(reported, (uint16_t)(0xFFF0 + 1 + ROUNDS - 1000));
+
+  return checkSummary("test_radio_reliable");
+}
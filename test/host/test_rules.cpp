@@ -0,0 +1,59 @@
+// Rules are published whole, and a threshold rule whose pin left analog input is reported.
+#include "pxt.h"
+
+#define private public
+#define protected public
+#include "MbitMoreDevice.h"
+#undef private
+#undef protected
+
+#include <algorithm>
+
+#include "check.h"
+
+static bool sent(const uint8_t *bytes, size_t length) {
+  return std::search(fake::serialTx.begin(), fake::serialTx.end(), bytes, bytes + length) != fake::serialTx.end();
+}
+
+int main() {
+  MbitMoreDevice &device = MbitMoreDevice::getInstance();
+  MicroBit &uBit = pxt::uBit;
+  device.serialConnected = true;
+
+  // Rule 2: P1 above 500 sets P8 high.
+  uBit.io.pin[1].value = 100;
+  uint8_t setRule[] = {
+      (uint8_t)((MbitMoreCommand::CMD_CONFIG << 5) | MbitMoreConfig::RULE), 2,
+      MbitMoreRuleTrigger::RULE_ABOVE, 1, 0xF4, 0x01,
+      MbitMoreRuleAction::ACTION_DIGITAL, 8, 1, 0, 0, 0};
+  device.onCommandReceived(setRule, sizeof(setRule));
+  CHECK_EQ(device.rules[2].trigger, MbitMoreRuleTrigger::RULE_ABOVE);
+  CHECK_EQ(device.rules[2].value, 500);
+  CHECK_EQ(device.rules[2].above, 0);
+  CHECK_EQ(uBit.io.pin[1].mode, 3);
+
+  // Crossing the threshold runs the action.
+  uBit.io.pin[1].value = 600;
+  fake::timeUs += MBIT_MORE_RULE_SAMPLE_INTERVAL * 1000;
+  device.checkRuleThresholds();
+  CHECK_EQ(uBit.io.pin[8].mode, 2);
+  CHECK_EQ(uBit.io.pin[8].value, 1);
+
+  // P1 becomes an output, then the rule is disabled and reported.
+  device.setDigitalValue(1, 0);
+  fake::serialTx.clear();
+  fake::timeUs += MBIT_MORE_RULE_SAMPLE_INTERVAL * 1000;
+  device.checkRuleThresholds();
+  CHECK_EQ(device.rules[2].trigger, MbitMoreRuleTrigger::RULE_NONE);
+  CHECK_EQ(uBit.io.pin[1].mode, 2);
+  uint8_t disabled[] = {MbitMoreActionEvent::RULE_DISABLED, 2, MbitMoreRuleTrigger::RULE_ABOVE, 1};
+  CHECK(sent(disabled, sizeof(disabled)));
+
+  // It is reported once.
+  fake::serialTx.clear();
+  fake::timeUs += MBIT_MORE_RULE_SAMPLE_INTERVAL * 1000;
+  device.checkRuleThresholds();
+  CHECK(fake::serialTx.empty());
+
+  return checkSummary("test_rules");
+}
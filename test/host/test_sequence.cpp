@@ -0,0 +1,74 @@
+// Steps of the output sequence are added only in order of the offset.
+#include "pxt.h"
+
+#define private public
+#define protected public
+#include "MbitMoreDevice.h"
+#undef private
+#undef protected
+
+#include "check.h"
+
+static void add(MbitMoreDevice &device, const uint32_t *offsets, const uint8_t *pins, int count) {
+  uint8_t data[1 + (MBIT_MORE_SEQUENCE_STEP_SIZE * 4)] = {0};
+  data[0] = (uint8_t)((MbitMoreCommand::CMD_SEQUENCE << 5) | MbitMoreSequenceCommand::SEQUENCE_ADD);
+  for (int i = 0; i < count; i++) {
+    uint8_t *step = &data[1 + (i * MBIT_MORE_SEQUENCE_STEP_SIZE)];
+    memcpy(step, &offsets[i], 4);
+    step[4] = pins[i];
+    step[5] = MbitMoreSequenceAction::STEP_DIGITAL;
+  }
+  device.onCommandReceived(data, 1 + (MBIT_MORE_SEQUENCE_STEP_SIZE * count));
+}
+
+int main() {
+  MbitMoreDevice &device = MbitMoreDevice::getInstance();
+
+  // Steps at the same offset on different pins run together.
+  uint32_t offsets[] = {0, 1000, 1000};
+  uint8_t pins[] = {0, 0, 1};
+  add(device, offsets, pins, 3);
+  CHECK_EQ(device.sequenceLength, 3);
+
+  // A step going back is rejected with the whole command.
+  uint32_t back[] = {2000, 500};
+  uint8_t backPins[] = {0, 0};
+  add(device, back, backPins, 2);
+  CHECK_EQ(device.sequenceLength, 3);
+
+  // A step before the steps already added is rejected.
+  uint32_t before[] = {900};
+  add(device, before, backPins, 1);
+  CHECK_EQ(device.sequenceLength, 3);
+
+  // Two steps on a pin at an offset overlap.
+  uint32_t same[] = {1000};
+  uint8_t samePins[] = {1};
+  add(device, same, samePins, 1);
+  CHECK_EQ(device.sequenceLength, 3);
+  uint32_t sameInCommand[] = {3000, 3000};
+  uint8_t sameInCommandPins[] = {2, 2};
+  add(device, sameInCommand, sameInCommandPins, 2);
+  CHECK_EQ(device.sequenceLength, 3);
+
+  // Steps after the last one are added.
+  uint32_t after[] = {1000, 2000};
+  uint8_t afterPins[] = {2, 0};
+  add(device, after, afterPins, 2);
+  CHECK_EQ(device.sequenceLength, 5);
+  CHECK_EQ(device.sequenceSteps[4].offset, 2000);
+
+  // A stopped sequence does not wait for the step.
+  device.sequencePlaying = false;
+  CHECK(!device.waitSequenceUntil((uint32_t)fake::timeUs + 5000));
+
+  // The step is waited without sleeping past it.
+  device.sequencePlaying = true;
+  device.sequenceRestart = false;
+  uint32_t target = (uint32_t)fake::timeUs + 20000;
+  CHECK(device.waitSequenceUntil(target));
+  CHECK((uint32_t)fake::timeUs - target < MBIT_MORE_SEQUENCE_SPIN_TIME);
+  CHECK(!device.sequenceWaiting);
+
+  return checkSummary("test_sequence");
+}